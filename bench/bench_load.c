@@ -0,0 +1,118 @@
+// Measures config_parse() and config_freeze() of a generated configuration of one large top-level table,
+// and config_parse_cached() when it writes the snapshot (cold) and when it loads it (warm).
+//
+// Usage: bench_load [keys] [rounds]
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <limits.h> // PATH_MAX
+#include "config_parser.h"
+
+static double now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+// Remove the snapshots of the cache directory, and the directory if 'remove_dir'.
+static void clear_cache(const char *cache, int remove_dir) {
+    DIR *d = opendir(cache);
+    struct dirent *entry;
+    while(d && (entry = readdir(d))) {
+        char path[PATH_MAX];
+        if(entry->d_name[0] != '.' && snprintf(path, sizeof(path), "%s/%s", cache, entry->d_name) < (int)sizeof(path)) {
+            unlink(path);
+        }
+    }
+    if(d) {
+        closedir(d);
+    }
+    if(remove_dir) {
+        rmdir(cache);
+    }
+}
+
+// config_parse_cached() of 'path', in seconds.
+static double parse_cached(const char *path, const char *cache) {
+    ConfigParser p;
+    double start = now();
+    ConfigTable *table = config_parse_cached(&p, path, cache);
+    double elapsed = now() - start;
+    if(!table) {
+        return -1;
+    }
+    config_end(&p);
+    return elapsed;
+}
+
+int main(int argc, char **argv) {
+    size_t key_count = argc > 1 ? strtoul(argv[1], NULL, 10) : 1000000;
+    size_t rounds = argc > 2 ? strtoul(argv[2], NULL, 10) : 5;
+
+    char path[] = "/tmp/bench_loadXXXXXX";
+    int fd = mkstemp(path);
+    FILE *f = fd < 0 ? NULL : fdopen(fd, "w");
+    if(!f) {
+        perror("mkstemp");
+        return 1;
+    }
+    for(size_t i = 0; i < key_count; ++i) {
+        fprintf(f, "key_%zu = %zu\n", i, i);
+    }
+    fclose(f);
+
+    // the best of 'rounds' runs.
+    double parse = 0, freeze = 0;
+    for(size_t i = 0; i < rounds; ++i) {
+        ConfigParser p;
+        double start = now();
+        ConfigTable *table = config_parse(&p, path);
+        double parsed = now();
+        if(!table || !config_freeze(&p)) {
+            fprintf(stderr, "Failed to load the benchmark config.\n");
+            unlink(path);
+            return 1;
+        }
+        double frozen = now();
+        if(i == 0 || parsed - start < parse) {
+            parse = parsed - start;
+        }
+        if(i == 0 || frozen - parsed < freeze) {
+            freeze = frozen - parsed;
+        }
+        config_end(&p);
+    }
+
+    char cache[] = "/tmp/bench_cacheXXXXXX";
+    if(!mkdtemp(cache)) {
+        perror("mkdtemp");
+        unlink(path);
+        return 1;
+    }
+    double cold = 0, warm = 0;
+    for(size_t i = 0; i < rounds; ++i) {
+        clear_cache(cache, 0);
+        double first = parse_cached(path, cache), second = parse_cached(path, cache);
+        if(first < 0 || second < 0) {
+            fprintf(stderr, "Failed to load the benchmark config with a cache.\n");
+            clear_cache(cache, 1);
+            unlink(path);
+            return 1;
+        }
+        if(i == 0 || first < cold) {
+            cold = first;
+        }
+        if(i == 0 || second < warm) {
+            warm = second;
+        }
+    }
+    clear_cache(cache, 1);
+    unlink(path);
+
+    printf("%zu keys: config_parse %.1f ms, config_freeze %.1f ms\n", key_count, parse * 1e3, freeze * 1e3);
+    printf("config_parse_cached: %.1f ms cold (writing the snapshot), %.1f ms warm\n", cold * 1e3, warm * 1e3);
+    return 0;
+}
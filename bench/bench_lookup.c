@@ -0,0 +1,79 @@
+// Measures config_get_number() on a frozen table.
+// Built with BENCH_INLINE the single header is compiled into the program
+// and config_get_number_inline() is used instead.
+//
+// Usage: bench_lookup_shared|bench_lookup_inline [keys] [lookups]
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+
+#ifdef BENCH_INLINE
+#define CONFIG_PARSER_IMPLEMENTATION
+#include "config_parser.h"
+#define GET_NUMBER config_get_number_inline
+#else
+#include "config_parser.h"
+#define GET_NUMBER config_get_number
+#endif
+
+static double now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+int main(int argc, char **argv) {
+    size_t key_count = argc > 1 ? strtoul(argv[1], NULL, 10) : 64;
+    size_t lookups = argc > 2 ? strtoul(argv[2], NULL, 10) : 50000000;
+
+    char path[] = "/tmp/bench_lookupXXXXXX";
+    int fd = mkstemp(path);
+    FILE *f = fd < 0 ? NULL : fdopen(fd, "w");
+    if(!f) {
+        perror("mkstemp");
+        return 1;
+    }
+    for(size_t i = 0; i < key_count; ++i) {
+        fprintf(f, "key_%zu = %zu\n", i, i);
+    }
+    fclose(f);
+
+    char **keys = malloc(key_count * sizeof(*keys));
+    for(size_t i = 0; i < key_count; ++i) {
+        keys[i] = malloc(32);
+        snprintf(keys[i], 32, "key_%zu", i);
+    }
+
+    ConfigParser p;
+    ConfigTable *table = config_parse(&p, path);
+    unlink(path);
+    if(!table || !config_freeze(&p)) {
+        fprintf(stderr, "Failed to load the benchmark config.\n");
+        return 1;
+    }
+
+    int64_t sum = 0;
+    double start = now();
+    for(size_t i = 0; i < lookups; ++i) {
+        ConfigValue value = GET_NUMBER(table, keys[i % key_count]);
+        sum += value.as.number;
+    }
+    double elapsed = now() - start;
+
+    printf("%s: %zu keys, %zu lookups, %.2f ns/lookup (checksum %lld)\n",
+#ifdef BENCH_INLINE
+           "inline",
+#else
+           "shared",
+#endif
+           key_count, lookups, elapsed * 1e9 / lookups, (long long)sum);
+
+    config_end(&p);
+    for(size_t i = 0; i < key_count; ++i) {
+        free(keys[i]);
+    }
+    free(keys);
+    return 0;
+}
@@ -0,0 +1,130 @@
+// Measures the token throughput of the scanner on a generated configuration:
+// one token at a time with scannerNextToken(), in batches with scannerScan()
+// (as the parser reads them), and the whole parser.
+// bench_tokens_unbatched is built with a parser that reads one token at a time.
+//
+// Usage: bench_tokens [tables] [pairs per table] [rounds]
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "scanner.h"
+#include "token.h"
+#include "array.h"
+#include "arena.h"
+#include "parser.h"
+
+#define BATCH_SIZE 64
+
+static double now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+// Every kind of token, with about as many keys as values.
+static char *generate(size_t tables, size_t pairs, size_t *length) {
+    size_t capacity = tables * (pairs + 2) * 64 + 1, used = 0;
+    char *source = malloc(capacity);
+    for(size_t t = 0; t < tables; ++t) {
+        used += sprintf(source + used, "[table_%zu]\n", t);
+        for(size_t i = 0; i < pairs; ++i) {
+            switch(i % 6) {
+                case 0: used += sprintf(source + used, "number_%zu = %zu\n", i, t * i); break;
+                case 1: used += sprintf(source + used, "string_%zu = \"value %zu\\n\"\n", i, i); break;
+                case 2: used += sprintf(source + used, "enabled_%zu = true\n", i); break;
+                case 3: used += sprintf(source + used, "timeout_%zu = 1m30s\n", i); break;
+                case 4: used += sprintf(source + used, "max_%zu = 16MiB\n", i); break;
+                case 5: used += sprintf(source + used, "'literal %zu' = 'raw'\n", i); break;
+            }
+        }
+        source[used++] = '\n';
+    }
+    source[used] = '\0';
+    *length = used;
+    return source;
+}
+
+static size_t scan_per_token(char *source, int64_t *checksum) {
+    Scanner s;
+    scannerInit(&s, source);
+    size_t count = 0;
+    Token tk;
+    do {
+        tk = scannerNextToken(&s);
+        *checksum += tk.at;
+        count++;
+    } while(tk.type != TK_EOF);
+    scannerFree(&s);
+    return count;
+}
+
+static size_t scan_batched(char *source, int64_t *checksum) {
+    Scanner s;
+    scannerInit(&s, source);
+    Token tokens[BATCH_SIZE];
+    size_t count = 0, n;
+    do {
+        n = scannerScan(&s, tokens, BATCH_SIZE);
+        for(size_t i = 0; i < n; ++i) {
+            *checksum += tokens[i].at;
+        }
+        count += n;
+    } while(tokens[n - 1].type != TK_EOF);
+    scannerFree(&s);
+    return count;
+}
+
+static size_t parse(char *source, int64_t *checksum) {
+    static Arena arena;
+    static bool initialized = false;
+    if(!initialized) {
+        arenaInit(&arena);
+        initialized = true;
+    }
+    arenaReset(&arena);
+    Array tables;
+    arrayInitArena(&tables, &arena);
+    *checksum += config_parser_parse(source, &tables, &arena) ? (int64_t)tables.used : -1;
+    return 0;
+}
+
+// The best of 'rounds' runs, in seconds.
+static double measure(size_t (*fn)(char *, int64_t *), char *source, size_t rounds, size_t *tokens, int64_t *checksum) {
+    double best = 0;
+    for(size_t i = 0; i < rounds; ++i) {
+        double start = now();
+        size_t count = fn(source, checksum);
+        double elapsed = now() - start;
+        if(i == 0 || elapsed < best) {
+            best = elapsed;
+        }
+        if(count) {
+            *tokens = count;
+        }
+    }
+    return best;
+}
+
+int main(int argc, char **argv) {
+    size_t table_count = argc > 1 ? strtoul(argv[1], NULL, 10) : 2000;
+    size_t pair_count = argc > 2 ? strtoul(argv[2], NULL, 10) : 30;
+    size_t rounds = argc > 3 ? strtoul(argv[3], NULL, 10) : 20;
+
+    size_t length;
+    char *source = generate(table_count, pair_count, &length);
+    size_t tokens = 0;
+    int64_t checksum = 0;
+
+    printf("%zu bytes, sizeof(Token) = %zu\n", length, sizeof(Token));
+    double elapsed = measure(scan_per_token, source, rounds, &tokens, &checksum);
+    printf("per token: %zu tokens, %.2f ns/token, %.0f MB/s\n", tokens, elapsed * 1e9 / tokens, length / elapsed / 1e6);
+    elapsed = measure(scan_batched, source, rounds, &tokens, &checksum);
+    printf("batched:   %zu tokens, %.2f ns/token, %.0f MB/s\n", tokens, elapsed * 1e9 / tokens, length / elapsed / 1e6);
+    elapsed = measure(parse, source, rounds, &tokens, &checksum);
+    printf("parser:    %zu tokens, %.2f ns/token, %.0f MB/s (checksum %lld)\n", tokens, elapsed * 1e9 / tokens, length / elapsed / 1e6, (long long)checksum);
+
+    free(source);
+    return 0;
+}
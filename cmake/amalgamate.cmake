@@ -0,0 +1,61 @@
+# Generate the single header distribution of the library:
+# the public header, followed by the internal headers (only with CONFIG_PARSER_IMPLEMENTATION
+# or CONFIG_PARSER_INLINE defined) and the sources (only with CONFIG_PARSER_IMPLEMENTATION defined).
+# Both are wrapped in extern "C" so C++ source files can use the inline accessors.
+#
+# Usage: cmake -DSOURCE_DIR=<repository root> -DSOURCES=<comma separated sources> -DOUTPUT=<file> -P amalgamate.cmake
+
+# The internal headers, in dependency order.
+set(HEADERS
+    arena.h
+    array.h
+    map.h
+    hash.h
+    phf.h
+    utf8.h
+    unescape.h
+    token.h
+    scanner.h
+    parser.h
+    config_internal.h
+    config_inline.h
+    snapshot.h
+    uring.h
+)
+
+string(REPLACE "," ";" SOURCES "${SOURCES}")
+
+# everything is in one file, so local includes are removed.
+function(append_file path)
+    file(READ "${path}" contents)
+    string(REGEX REPLACE "#include \"[^\"]*\"[^\n]*\n" "" contents "${contents}")
+    get_filename_component(name "${path}" NAME)
+    file(APPEND "${OUTPUT}" "\n/* ${name} */\n\n${contents}\n")
+endfunction()
+
+file(READ "${SOURCE_DIR}/include/config_parser.h" public_header)
+file(WRITE "${OUTPUT}" "// Single header distribution of configuration_parser, generated by cmake/amalgamate.cmake.\n")
+file(APPEND "${OUTPUT}" "//\n")
+file(APPEND "${OUTPUT}" "// Define CONFIG_PARSER_IMPLEMENTATION in exactly one source file before including this header\n")
+file(APPEND "${OUTPUT}" "// to compile the library into it, and CONFIG_PARSER_INLINE in any source file that wants to\n")
+file(APPEND "${OUTPUT}" "// use the inline config_get_*_inline() accessors.\n\n")
+file(APPEND "${OUTPUT}" "${public_header}\n")
+
+set(EXTERN_C_BEGIN "#ifdef __cplusplus\nextern \"C\" {\n#endif\n")
+set(EXTERN_C_END "#ifdef __cplusplus\n}\n#endif\n")
+
+file(APPEND "${OUTPUT}" "\n#if defined(CONFIG_PARSER_IMPLEMENTATION) || defined(CONFIG_PARSER_INLINE)\n")
+file(APPEND "${OUTPUT}" "${EXTERN_C_BEGIN}")
+foreach(header ${HEADERS})
+    append_file("${SOURCE_DIR}/include/${header}")
+endforeach()
+file(APPEND "${OUTPUT}" "${EXTERN_C_END}")
+file(APPEND "${OUTPUT}" "#endif // CONFIG_PARSER_IMPLEMENTATION || CONFIG_PARSER_INLINE\n")
+
+file(APPEND "${OUTPUT}" "\n#ifdef CONFIG_PARSER_IMPLEMENTATION\n")
+file(APPEND "${OUTPUT}" "${EXTERN_C_BEGIN}")
+foreach(source ${SOURCES})
+    append_file("${source}")
+endforeach()
+file(APPEND "${OUTPUT}" "${EXTERN_C_END}")
+file(APPEND "${OUTPUT}" "#endif // CONFIG_PARSER_IMPLEMENTATION\n")
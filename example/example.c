@@ -42,6 +42,28 @@ int main(void) {
         puts("Error getting 'valid' key in table 'test2'");
     }
 
+    // print every table and its pairs.
+    ConfigIter tables = config_tables_iter(&p);
+    ConfigTable *table;
+    const char *name;
+    while(config_tables_next(&tables, &table, &name)) {
+        printf("[%s]\n", name);
+        ConfigIter pairs = config_table_iter(table);
+        const char *key;
+        ConfigType type;
+        while(config_iter_next(&pairs, &key, &type, &val)) {
+            switch(type) {
+                case CONFIG_TYPE_NUMBER: printf("%s = %ld\n", key, (long)val.as.number); break;
+                case CONFIG_TYPE_BOOLEAN: printf("%s = %s\n", key, val.as.boolean ? "true" : "false"); break;
+                case CONFIG_TYPE_STRING: printf("%s = \"%s\"\n", key, val.as.string); break;
+                case CONFIG_TYPE_DATETIME: printf("%s = %lds since the epoch\n", key, (long)(val.as.datetime / 1000000000)); break;
+                case CONFIG_TYPE_DURATION: printf("%s = %ldms\n", key, (long)(val.as.duration / 1000000)); break;
+                case CONFIG_TYPE_SIZE: printf("%s = %ld bytes\n", key, (long)val.as.size); break;
+                default: break;
+            }
+        }
+    }
+
 end:
     config_end(&p);
     return 0;
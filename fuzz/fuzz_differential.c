@@ -0,0 +1,98 @@
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include "scanner.h"
+#include "token.h"
+#include "unescape.h"
+#include "utf8.h"
+#include "reference.h"
+
+#define BATCH_SIZE 7
+
+#define CHECK(cond, ...) do { \
+        if(!(cond)) { \
+            fprintf(stderr, "Mismatch: " __VA_ARGS__); \
+            fputc('\n', stderr); \
+            abort(); \
+        } \
+    } while(0)
+
+static void compare_tokens(Token a, Token b) {
+    CHECK(a.type == b.type, "token type '%s' != '%s'", tokenTypeString(a.type), tokenTypeString(b.type));
+    CHECK(a.at == b.at, "token position %u != %u", (unsigned)a.at, (unsigned)b.at);
+    switch(a.type) {
+        case TK_NUMBER:
+        case TK_DATETIME:
+        case TK_DURATION:
+        case TK_SIZE:
+            CHECK(a.as.number == b.as.number, "number %ld != %ld", (long)a.as.number, (long)b.as.number);
+            break;
+        case TK_STRING:
+        case TK_IDENTIFIER:
+        case TK_TRUE:
+        case TK_FALSE:
+            CHECK(a.as.slice.start == b.as.slice.start &&
+                  a.as.slice.length == b.as.slice.length &&
+                  a.flags == b.flags,
+                  "string or identifier at %u", (unsigned)a.at);
+            break;
+        default:
+            break;
+    }
+}
+
+static void compare_unescape(char *source, Token tk) {
+    size_t length = tk.as.slice.length;
+    char *a = malloc(length + 1), *b = malloc(length + 1);
+    size_t a_length = unescapeString(source + tk.as.slice.start, length, a);
+    size_t b_length = refUnescapeString(source + tk.as.slice.start, length, b);
+    CHECK(a_length == b_length && memcmp(a, b, a_length) == 0, "unescaped string at %u", (unsigned)tk.at);
+    free(a);
+    free(b);
+}
+
+int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size) {
+    char *source = malloc(size + 1);
+    memcpy(source, data, size);
+    source[size] = '\0';
+    size_t length = strlen(source);
+
+    size_t valid = utf8Validate(source, length);
+    CHECK(valid == refUtf8Validate(source, length), "utf8Validate()");
+    // the scanner only ever sees valid UTF-8.
+    source[valid] = '\0';
+
+    Scanner optimized, reference, batched;
+    scannerInit(&optimized, source);
+    refScannerInit(&reference, source);
+    // the parser's batches are the per-token stream without the error tokens,
+    // small batches end in the middle of lines and of multi-token constructs.
+    scannerInit(&batched, source);
+    Token batch[BATCH_SIZE];
+    size_t batch_used = 0, batch_count = 0;
+    Token a, b;
+    do {
+        a = scannerNextToken(&optimized);
+        b = refScannerNextToken(&reference);
+        compare_tokens(a, b);
+        if(a.type == TK_STRING && (a.flags & TOKEN_HAS_ESCAPES)) {
+            compare_unescape(source, a);
+        }
+        if(a.type != TK_ERROR) {
+            if(batch_used == batch_count) {
+                batch_count = scannerScan(&batched, batch, BATCH_SIZE);
+                batch_used = 0;
+            }
+            compare_tokens(a, batch[batch_used++]);
+        }
+    } while(a.type != TK_EOF);
+    CHECK(batch_used == batch_count, "tokens after the end of the batch stream");
+    CHECK(optimized.had_error == batched.had_error, "batch errors");
+    scannerFree(&optimized);
+    refScannerFree(&reference);
+    scannerFree(&batched);
+
+    free(source);
+    return 0;
+}
@@ -0,0 +1,24 @@
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include "array.h"
+#include "arena.h"
+#include "parser.h"
+#include "config_internal.h"
+
+int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size) {
+    char *source = malloc(size + 1);
+    memcpy(source, data, size);
+    source[size] = '\0';
+
+    Arena arena;
+    arenaInit(&arena);
+    Array tables;
+    arrayInit(&tables);
+    config_parser_parse(source, &tables, &arena);
+    arrayFree(&tables);
+    arenaFree(&arena);
+
+    free(source);
+    return 0;
+}
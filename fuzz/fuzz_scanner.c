@@ -0,0 +1,23 @@
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include "scanner.h"
+#include "token.h"
+
+int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size) {
+    // the scanner expects a NUL terminated source.
+    char *source = malloc(size + 1);
+    memcpy(source, data, size);
+    source[size] = '\0';
+
+    Scanner s;
+    scannerInit(&s, source);
+    Token tk;
+    do {
+        tk = scannerNextToken(&s);
+    } while(tk.type != TK_EOF);
+    scannerFree(&s);
+
+    free(source);
+    return 0;
+}
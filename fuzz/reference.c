@@ -0,0 +1,19 @@
+// The reference implementation used by fuzz_differential.c:
+// the scanner and the string helpers built without their SIMD fast paths.
+// Their public functions are renamed so they can be linked alongside the optimized build.
+
+#define CONFIG_PARSER_NO_SIMD
+
+#define utf8Encode refUtf8Encode
+#define utf8SequenceLength refUtf8SequenceLength
+#define utf8Validate refUtf8Validate
+#define unescapeString refUnescapeString
+#define scannerInit refScannerInit
+#define scannerFree refScannerFree
+#define scannerNextToken refScannerNextToken
+#define scannerScan refScannerScan
+#define scannerLine refScannerLine
+
+#include "../src/utf8.c"
+#include "../src/unescape.c"
+#include "../src/scanner.c"
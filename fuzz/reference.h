@@ -0,0 +1,19 @@
+#ifndef REFERENCE_H
+#define REFERENCE_H
+
+#include <stddef.h>
+#include "scanner.h"
+#include "token.h"
+
+// The reference (scalar) implementations built by reference.c.
+// They have the same contracts as the functions they are named after.
+
+size_t refUtf8Validate(const char *s, size_t length);
+size_t refUnescapeString(const char *src, size_t length, char *dest);
+void refScannerInit(Scanner *s, char *source);
+void refScannerFree(Scanner *s);
+Token refScannerNextToken(Scanner *s);
+size_t refScannerScan(Scanner *s, Token *tokens, size_t capacity);
+int refScannerLine(Scanner *s, size_t at);
+
+#endif // REFERENCE_H
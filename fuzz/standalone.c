@@ -0,0 +1,40 @@
+// A driver for compilers without libFuzzer: runs the fuzz target once for every
+// file given on the command line, or once for stdin if there are none.
+// AFL++ builds that don't support -fsanitize=fuzzer (e.g afl-gcc-fast) use it as well: afl-fuzz ... -- ./fuzz_parser @@
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size);
+
+static int run(FILE *fp) {
+    size_t size = 0, capacity = 4096;
+    uint8_t *data = malloc(capacity);
+    size_t n;
+    while((n = fread(data + size, 1, capacity - size, fp)) > 0) {
+        size += n;
+        if(size == capacity) {
+            capacity *= 2;
+            data = realloc(data, capacity);
+        }
+    }
+    int result = LLVMFuzzerTestOneInput(data, size);
+    free(data);
+    return result;
+}
+
+int main(int argc, char **argv) {
+    if(argc < 2) {
+        return run(stdin);
+    }
+    for(int i = 1; i < argc; ++i) {
+        FILE *fp = fopen(argv[i], "rb");
+        if(!fp) {
+            perror(argv[i]);
+            return EXIT_FAILURE;
+        }
+        run(fp);
+        fclose(fp);
+    }
+    return EXIT_SUCCESS;
+}
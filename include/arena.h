@@ -0,0 +1,72 @@
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <stddef.h> // size_t
+
+// The minimum size of a block.
+#define ARENA_BLOCK_SIZE 4096
+
+typedef struct arena_block {
+    struct arena_block *next;
+    char *data; // the memory of the block, which directly follows it.
+    size_t size, used;
+} ArenaBlock;
+
+// A bump allocator: everything allocated from an arena is freed at once
+// by arenaReset() or arenaFree().
+typedef struct arena {
+    ArenaBlock *blocks; // the current block is the first one.
+} Arena;
+
+/***
+ * Initialize an arena, no memory is allocated until the first allocation.
+ *
+ * @param a The Arena to initialize.
+ ***/
+void arenaInit(Arena *a);
+
+/***
+ * Free an arena and everything allocated from it.
+ *
+ * @param a An Arena.
+ ***/
+void arenaFree(Arena *a);
+
+/***
+ * Free everything allocated from an arena but keep its memory.
+ * If the arena grew past its first block, the blocks are merged into one
+ * so that allocating as much again doesn't need any new block.
+ *
+ * @param a An Arena.
+ ***/
+void arenaReset(Arena *a);
+
+/***
+ * Allocate memory from an arena, the memory is suitably aligned for any type.
+ *
+ * @param a An Arena.
+ * @param size The number of bytes to allocate.
+ * @return A pointer to the memory, or NULL if a block couldn't be allocated.
+ ***/
+void *arenaAlloc(Arena *a, size_t size);
+
+/***
+ * Allocate zeroed memory from an arena.
+ *
+ * @param a An Arena.
+ * @param size The number of bytes to allocate.
+ * @return A pointer to the memory, or NULL if a block couldn't be allocated.
+ ***/
+void *arenaCalloc(Arena *a, size_t size);
+
+/***
+ * Copy a string into an arena.
+ *
+ * @param a An Arena.
+ * @param s A string.
+ * @param length The number of bytes of 's' to copy.
+ * @return The NUL terminated copy, or NULL if a block couldn't be allocated.
+ ***/
+char *arenaStrndup(Arena *a, const char *s, size_t length);
+
+#endif // ARENA_H
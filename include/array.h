@@ -5,12 +5,20 @@
 
 #define ARRAY_INITIAL_CAPACITY 8
 
+struct arena;
+
 typedef struct array {
     void **data;
     size_t used, capacity;
+    struct arena *arena; // if not NULL, 'data' is allocated from this arena.
 } Array;
 
 void arrayInit(Array *a);
+// The array's memory belongs to the arena, arrayFree() only forgets it.
+void arrayInitArena(Array *a, struct arena *arena);
+// Same as arrayInitArena(), with room for at least 'capacity' elements.
+void arrayInitArenaCapacity(Array *a, struct arena *arena, size_t capacity);
+void arrayClear(Array *a);
 void arrayFree(Array *a);
 int arrayPush(Array *a, void *value);
 void *arrayPop(Array *a);
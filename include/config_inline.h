@@ -0,0 +1,142 @@
+#ifndef CONFIG_INLINE_H
+#define CONFIG_INLINE_H
+
+// Inline versions of the config_get_*() functions, for code that knows the layout
+// of ConfigTable: code that uses the single header with CONFIG_PARSER_INLINE defined,
+// or that is linked with the static library. They can't be used with the shared library.
+
+#include <string.h> // strlen, strcmp, memset, memcpy
+#include <errno.h>
+#include "config_internal.h"
+#include "parser.h"
+#include "phf.h"
+
+static inline Pair *config_find_pair_inline(ConfigTable *t, const char *key) {
+    if(t->slots) {
+        Pair *pair = t->slots[phfLookup(&t->phf, key, strlen(key))];
+        return strcmp(pair->key, key) ? NULL : pair;
+    }
+    for(size_t i = 0; i < t->pairs.used; ++i) {
+        Pair *pair = (Pair *)t->pairs.data[i];
+        if(!strcmp(pair->key, key)) {
+            return pair;
+        }
+    }
+    return NULL;
+}
+
+// The value of a pair (NULL for a failed lookup), built without a compound literal
+// so the header can be used from C++. Literal and ConfigValue have the same union.
+static inline ConfigValue config_value_inline(const Pair *pair) {
+    ConfigValue value;
+    memset(&value, 0, sizeof(value));
+    if(pair) {
+        value.ok = true;
+        memcpy(&value.as, &pair->value.as, sizeof(value.as));
+    }
+    return value;
+}
+
+// Same as config_get_string().
+static inline ConfigValue config_get_string_inline(ConfigTable *t, const char *key) {
+    Pair *pair = config_find_pair_inline(t, key);
+    if(!pair) {
+        errno = EINVAL;
+        return config_value_inline(NULL);
+    }
+    return config_value_inline(pair->value.type == LIT_STRING ? pair : NULL);
+}
+
+// Same as config_get_number().
+static inline ConfigValue config_get_number_inline(ConfigTable *t, const char *key) {
+    Pair *pair = config_find_pair_inline(t, key);
+    if(!pair) {
+        errno = EINVAL;
+        return config_value_inline(NULL);
+    }
+    return config_value_inline(pair->value.type == LIT_NUMBER ? pair : NULL);
+}
+
+// Same as config_get_boolean().
+static inline ConfigValue config_get_boolean_inline(ConfigTable *t, const char *key) {
+    Pair *pair = config_find_pair_inline(t, key);
+    if(!pair) {
+        errno = EINVAL;
+        return config_value_inline(NULL);
+    }
+    return config_value_inline(pair->value.type == LIT_BOOLEAN ? pair : NULL);
+}
+
+// Same as config_get_datetime().
+static inline ConfigValue config_get_datetime_inline(ConfigTable *t, const char *key) {
+    Pair *pair = config_find_pair_inline(t, key);
+    if(!pair) {
+        errno = EINVAL;
+        return config_value_inline(NULL);
+    }
+    return config_value_inline(pair->value.type == LIT_DATETIME ? pair : NULL);
+}
+
+// Same as config_get_duration().
+static inline ConfigValue config_get_duration_inline(ConfigTable *t, const char *key) {
+    Pair *pair = config_find_pair_inline(t, key);
+    if(!pair) {
+        errno = EINVAL;
+        return config_value_inline(NULL);
+    }
+    return config_value_inline(pair->value.type == LIT_DURATION ? pair : NULL);
+}
+
+// Same as config_get_size().
+static inline ConfigValue config_get_size_inline(ConfigTable *t, const char *key) {
+    Pair *pair = config_find_pair_inline(t, key);
+    if(!pair) {
+        errno = EINVAL;
+        return config_value_inline(NULL);
+    }
+    return config_value_inline(pair->value.type == LIT_SIZE ? pair : NULL);
+}
+
+// Same as config_get_type().
+static inline ConfigType config_get_type_inline(ConfigTable *t, const char *key) {
+    Pair *pair = config_find_pair_inline(t, key);
+    return pair ? (ConfigType)pair->value.type : CONFIG_TYPE_NONE;
+}
+
+// Same as config_get_string_or().
+static inline const char *config_get_string_or_inline(ConfigTable *t, const char *key, const char *def) {
+    Pair *pair = config_find_pair_inline(t, key);
+    return pair && pair->value.type == LIT_STRING ? pair->value.as.string : def;
+}
+
+// Same as config_get_number_or().
+static inline int64_t config_get_number_or_inline(ConfigTable *t, const char *key, int64_t def) {
+    Pair *pair = config_find_pair_inline(t, key);
+    return pair && pair->value.type == LIT_NUMBER ? pair->value.as.number : def;
+}
+
+// Same as config_get_boolean_or().
+static inline bool config_get_boolean_or_inline(ConfigTable *t, const char *key, bool def) {
+    Pair *pair = config_find_pair_inline(t, key);
+    return pair && pair->value.type == LIT_BOOLEAN ? pair->value.as.boolean : def;
+}
+
+// Same as config_get_datetime_or().
+static inline int64_t config_get_datetime_or_inline(ConfigTable *t, const char *key, int64_t def) {
+    Pair *pair = config_find_pair_inline(t, key);
+    return pair && pair->value.type == LIT_DATETIME ? pair->value.as.datetime : def;
+}
+
+// Same as config_get_duration_or().
+static inline int64_t config_get_duration_or_inline(ConfigTable *t, const char *key, int64_t def) {
+    Pair *pair = config_find_pair_inline(t, key);
+    return pair && pair->value.type == LIT_DURATION ? pair->value.as.duration : def;
+}
+
+// Same as config_get_size_or().
+static inline int64_t config_get_size_or_inline(ConfigTable *t, const char *key, int64_t def) {
+    Pair *pair = config_find_pair_inline(t, key);
+    return pair && pair->value.type == LIT_SIZE ? pair->value.as.size : def;
+}
+
+#endif // CONFIG_INLINE_H
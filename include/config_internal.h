@@ -4,28 +4,104 @@
 #include <stddef.h> // size_t
 #include <stdint.h>
 #include <stdbool.h>
+#include <time.h> // struct timespec
+#include <sys/types.h> // dev_t, ino_t, off_t
+#include <sys/stat.h> // struct stat
+#include "config_parser.h" // ConfigValue, ConfigType, ConfigIter, ConfigParser
 #include "array.h"
-
-// A view into a Literal.
-// change version in config_parser.h when changing here.
-typedef struct config_value {
-    bool ok;
-    union {
-        int64_t number;
-        bool boolean;
-        char *string;
-    } as;
-} ConfigValue;
+#include "arena.h"
+#include "map.h"
+#include "phf.h"
 
 typedef struct config_table {
     char *name;
     Array pairs; // Array<Pair *>
+    // set by config_freeze(): the pairs in the slots of a perfect hash of their keys.
+    Phf phf;
+    struct config_pair **slots; // NULL if the table isn't frozen.
+    bool distinct_keys; // set once no key is known to be defined twice, so it isn't checked again.
 } ConfigTable;
 
-// change version in config_parser.h when changing here.
-typedef struct config_parser {
-    Array *tables; // Array<ConfigTable *>
-    char *config_file_path;
-} ConfigParser;
+// A configuration file and its parsed tables, cached by inode and mtime.
+typedef struct config_file {
+    char *path;
+    size_t path_capacity;
+    dev_t device;
+    ino_t inode;
+    struct timespec mtime;
+    off_t size;
+    bool committed; // false until 'tables' holds a successfully merged version of the file.
+    bool visited; // set when the file is part of the configuration being built.
+    Array tables; // Array<ConfigTable *>, allocated from arenas[current].
+    // the tables of a new version of the file, which replace 'tables'
+    // once the whole configuration was built successfully.
+    Array *pending; // Array<ConfigTable *>, allocated from arenas[!current].
+    Arena arenas[2];
+    int current;
+} ConfigFile;
+
+// The memory a parser keeps between configurations, so that once it has seen
+// configurations as large as the next one config_reparse() doesn't allocate.
+typedef struct config_pool {
+    Array files; // Array<ConfigFile *>, ConfigParser.files points to it.
+    Array spare_files; // Array<ConfigFile *>, files that are no longer used but keep their memory.
+    // ConfigParser.tables is allocated from table_arenas[current_tables],
+    // the other arena is used to build the next version of the tables.
+    Arena table_arenas[2];
+    int current_tables;
+    char *path; // ConfigParser.config_file_path points to it.
+    size_t path_capacity;
+    char *buffer; // the contents of the file being parsed.
+    size_t buffer_capacity;
+    // used while merging the files.
+    Map table_indices; // table name -> index in the merged tables.
+    Array pair_indices; // Array<Map *>, key -> index in the pairs of the merged table at the same index.
+    Array stack; // Array<ConfigFile *>, the files being merged.
+    // an open addressing set of the keys of a table, used to find out if it has to be merged.
+    // An entry holds the high 32 bits of the hash of a key and the index of its pair + 1 (0 if it is empty).
+    uint64_t *key_set;
+    size_t key_set_capacity;
+    // the tables returned by config_chain(), allocated from table_arenas[current_tables].
+    Array chains; // Array<ConfigTable *>
+    // the directory of the snapshot cache (see snapshot.h), NULL if there is none.
+    char *cache_dir;
+    size_t cache_dir_capacity;
+    // the options of config_parse_with_options().
+    bool includes;
+    bool expand_env;
+    // set by config_parse_many() when it already read the top-level file into 'buffer'.
+    bool preloaded;
+    struct stat preloaded_stat;
+} ConfigPool;
+
+/***
+ * Initialize a parser with an empty pool.
+ * sets errno.
+ *
+ * @param p An uninitialized ConfigParser.
+ * @return true on success, false on failure.
+ ***/
+bool config_init_parser(ConfigParser *p);
+
+/***
+ * Set the options of an initialized parser: the directory of the snapshot cache,
+ * includes and the expansion of environment variables.
+ * sets errno.
+ *
+ * @param p An initialized ConfigParser.
+ * @param opts The options, cache_dir may be NULL to keep the parser without a cache.
+ * @return true on success, false on failure.
+ ***/
+bool config_set_options(ConfigParser *p, const ConfigParseOptions *opts);
+
+/***
+ * Parse a configuration into an initialized parser that has no configuration.
+ * sets errno.
+ *
+ * @param p An initialized ConfigParser.
+ * @param config_file_path The path to the configuration file.
+ * @return A pointer to the top-level table or NULL on failure.
+ ***/
+ConfigTable *config_load(ConfigParser *p, const char *config_file_path);
 
 #endif // CONFIG_H
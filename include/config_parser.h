@@ -7,6 +7,14 @@ extern "C" {
 
 #include <stdint.h>
 #include <stdbool.h>
+#include <stddef.h> // size_t
+
+// Public functions are exported even when the library is built with -fvisibility=hidden.
+#ifdef __GNUC__
+#define CONFIG_PARSER_API __attribute__((visibility("default")))
+#else
+#define CONFIG_PARSER_API
+#endif
 
 /* types */
 typedef struct array Array;
@@ -19,14 +27,48 @@ typedef struct config_value {
         int64_t number;
         bool boolean;
         char *string;
+        int64_t datetime; // nanoseconds since the Unix epoch (UTC)
+        int64_t duration; // nanoseconds
+        int64_t size; // bytes
     } as;
 } ConfigValue;
 
+// The values match LiteralType.
+typedef enum config_type {
+    CONFIG_TYPE_NONE,
+    CONFIG_TYPE_NUMBER,
+    CONFIG_TYPE_BOOLEAN,
+    CONFIG_TYPE_STRING,
+    CONFIG_TYPE_DATETIME,
+    CONFIG_TYPE_DURATION,
+    CONFIG_TYPE_SIZE
+} ConfigType;
+
+// A cursor over the pairs of a table or over the tables of a parser.
+// It lives on the stack and doesn't need to be freed.
+typedef struct config_iter {
+    void **current, **end;
+} ConfigIter;
+
 typedef struct config_parser {
     Array *tables; // Array<ConfigTable *>
     char *config_file_path;
+    Array *files; // Array<ConfigFile *>
+    struct config_pool *pool; // the memory kept by config_reset().
 } ConfigParser;
 
+// Options of config_parse_with_options() and config_parse_many(), zero (or a NULL pointer)
+// selects the default of every option. config_parse_with_options() only uses the last three.
+typedef struct config_parse_options {
+    int threads; // the number of threads that parse the files, 0 for the number of CPUs.
+    int queue_depth; // the number of files read at the same time with io_uring, 0 for 64.
+    bool no_io_uring; // read the files with blocking I/O on the parsing threads even if io_uring is available.
+    int *errors; // if not NULL, errors[i] is set to 0 if paths[i] was parsed and to an errno value if it wasn't.
+    const char *cache_dir; // if not NULL, the snapshot cache directory (see config_parse_cached()).
+    bool includes; // merge the files named by top-level 'include' pairs (see config_parse_with_options()).
+    bool expand_env; // expand environment variables in string values (see config_parse_with_options()).
+} ConfigParseOptions;
+
 /* functions */
 
 /***
@@ -36,22 +78,134 @@ typedef struct config_parser {
  * @param config_file_path The path to the configuration file.
  * @return A pointer to the top-level table or NULL on failure and errno is set.
  ***/
-ConfigTable *config_parse(ConfigParser *p, const char *config_file_path);
+CONFIG_PARSER_API ConfigTable *config_parse(ConfigParser *p, const char *config_file_path);
+
+/***
+ * Parse a configuration file with options.
+ * With 'includes', a top-level pair 'include = "path"' merges the file at 'path' (relative
+ * to the directory of the including file) into the configuration at the point of the pair,
+ * later definitions of a key replacing earlier ones. Include cycles fail with ELOOP.
+ * With 'expand_env', ${NAME} in a string value is replaced with the value of the environment
+ * variable NAME, ${NAME:-default} falls back to 'default' if it isn't set, and $${ is a literal ${.
+ * A variable that isn't set and has no default fails with EINVAL.
+ * Without them (as with config_parse()), 'include' is an ordinary key and strings are kept as they are.
+ * The options are kept by config_reload() and config_reparse().
+ *
+ * @param p An *uninitialized* ConfigParser.
+ * @param config_file_path The path to the configuration file.
+ * @param opts The options (only cache_dir, includes and expand_env are used), or NULL for the defaults.
+ * @return A pointer to the top-level table or NULL on failure and errno is set.
+ ***/
+CONFIG_PARSER_API ConfigTable *config_parse_with_options(ConfigParser *p, const char *config_file_path, const ConfigParseOptions *opts);
+
+/***
+ * Parse a configuration file using a cache of parsed files.
+ * Same as config_parse_with_options() with only the cache_dir option.
+ * The tables parsed from every file (the configuration file and the files it includes)
+ * are saved in 'cache_dir', in a snapshot named after the hash of the file's absolute path.
+ * Files with a valid snapshot are loaded from it instead of being parsed. A snapshot is valid if it was
+ * made from the same device, inode, size and mtime as the file's and from contents with the same hash.
+ * Snapshots that are corrupt or were made from another version of the file are ignored and replaced.
+ * The parser keeps using the cache in config_reload() and config_reparse().
+ * Fails with EACCES if the cache directory isn't owned by the effective user of the process
+ * or is writable by its group or others, as a snapshot is trusted like the file it was made from.
+ *
+ * @param p An *uninitialized* ConfigParser.
+ * @param config_file_path The path to the configuration file.
+ * @param cache_dir An existing directory, writable to save new snapshots.
+ * @return A pointer to the top-level table or NULL on failure and errno is set.
+ ***/
+CONFIG_PARSER_API ConfigTable *config_parse_cached(ConfigParser *p, const char *config_file_path, const char *cache_dir);
+
+/***
+ * Remove the stale files of a snapshot cache: the snapshots whose file no longer exists,
+ * the snapshots that are corrupt or of another version of the library, and the temporary
+ * files that writers which died left behind (older than a minute).
+ * The snapshot of a file that changed replaces the previous one, so the cache only grows
+ * with the number of files. Pruning is only needed for the files that are deleted or renamed.
+ *
+ * @param cache_dir The cache directory.
+ * @return true on success, false on failure and errno is set (EACCES if the directory can't be trusted).
+ ***/
+CONFIG_PARSER_API bool config_cache_prune(const char *cache_dir);
+
+/***
+ * Reload a configuration file parsed with config_parse().
+ * Only the files (the configuration file and the files it includes) whose mtime
+ * changed since they were last read are read and parsed again.
+ * All tables returned before are invalidated on success.
+ * On failure the previous configuration is kept.
+ *
+ * @param p An initialized ConfigParser.
+ * @return A pointer to the top-level table or NULL on failure and errno is set.
+ ***/
+CONFIG_PARSER_API ConfigTable *config_reload(ConfigParser *p);
+
+/***
+ * Freeze a parsed configuration for faster lookups.
+ * A minimal perfect hash of the keys of every table is built, so looking up a key
+ * in a frozen table costs one hash and one key comparison.
+ * The configuration is frozen again after every successful config_reload().
+ *
+ * @param p An initialized ConfigParser.
+ * @return true on success, false on failure and errno is set (EINVAL if there is no configuration).
+ ***/
+CONFIG_PARSER_API bool config_freeze(ConfigParser *p);
+
+/***
+ * Parse many configuration files.
+ * The files are opened and read with io_uring when it is available, and are parsed
+ * on a pool of threads as their reads complete. Otherwise the threads read the files
+ * with blocking I/O. Files included by the configuration files are read with blocking I/O.
+ * Every file is parsed as with config_parse_with_options(): the parsers of the files that couldn't be
+ * parsed are freed, and the others have to be freed with config_end().
+ *
+ * @param paths The paths to the configuration files.
+ * @param n The number of paths.
+ * @param parsers An array of n *uninitialized* ConfigParsers.
+ * @param opts The options, or NULL for the defaults.
+ * @return The number of configuration files that were parsed.
+ ***/
+CONFIG_PARSER_API size_t config_parse_many(const char **paths, size_t n, ConfigParser *parsers, const ConfigParseOptions *opts);
+
+/***
+ * Forget the parsed configuration but keep the parser's memory,
+ * so that the next config_reparse() can reuse it.
+ * The tables of the configuration can't be used after this, and until the next
+ * successful config_reparse() the parser has no tables, as after a failed one.
+ *
+ * @param p An initialized ConfigParser.
+ ***/
+CONFIG_PARSER_API void config_reset(ConfigParser *p);
+
+/***
+ * Parse a configuration file reusing the memory of a parser.
+ * The previous configuration is forgotten as with config_reset().
+ * Once the parser has seen configurations as large as the new one,
+ * no memory is allocated (unless the configuration is frozen).
+ * Unlike config_parse(), the parser keeps its memory on failure
+ * and still has to be freed with config_end().
+ *
+ * @param p A ConfigParser that was used with config_parse(), or a zero initialized one.
+ * @param config_file_path The path to the configuration file.
+ * @return A pointer to the top-level table or NULL on failure and errno is set.
+ ***/
+CONFIG_PARSER_API ConfigTable *config_reparse(ConfigParser *p, const char *config_file_path);
 
 /***
  * Free a configuration parser.
  *
  * @param p The ConfigParser to free.
  ***/
-void config_end(ConfigParser *p);
+CONFIG_PARSER_API void config_end(ConfigParser *p);
 
 /***
  * Return the amount of top-level tables.
  *
  * @param p An initialized ConfigParser.
- * @return The number of top-level tables.
+ * @return The number of top-level tables, 0 if there is no configuration (see config_reset()).
  ***/
-int config_table_count(ConfigParser *p);
+CONFIG_PARSER_API int config_table_count(ConfigParser *p);
 
 
 /***
@@ -59,9 +213,74 @@ int config_table_count(ConfigParser *p);
  *
  * @param p An initialized ConfigParser.
  * @param name The name of the table.
- * @return A pointer to the table or NULL on failure and errno is set to EINVAL.
+ * @return A pointer to the table or NULL on failure (including when there is no configuration) and errno is set to EINVAL.
  ***/
-ConfigTable *config_get_table(ConfigParser *p, const char *name);
+CONFIG_PARSER_API ConfigTable *config_get_table(ConfigParser *p, const char *name);
+
+/***
+ * Build a table that looks keys up in a chain of tables, for example a [host]
+ * table that falls back to a [defaults] table.
+ * The pairs of the tables are merged once into a frozen table: a key is taken from
+ * the first table of the chain that has it, and looking it up costs one probe.
+ * The table is owned by the parser. Like the tables of the configuration it is
+ * invalidated by a successful config_reload(), config_reset(), config_reparse() and config_end(),
+ * after which the chain has to be built again from the new tables.
+ *
+ * @param p An initialized ConfigParser.
+ * @param tables The tables of p's configuration, from the first to the last looked up.
+ * @param n The number of tables.
+ * @return The merged table, named after the first table, or NULL on failure and errno is set.
+ ***/
+CONFIG_PARSER_API ConfigTable *config_chain(ConfigParser *p, ConfigTable **tables, size_t n);
+
+/***
+ * Get the name of a table.
+ *
+ * @param t A ConfigTable.
+ * @return The name of the table ("__toplevel__" for the top-level table).
+ ***/
+CONFIG_PARSER_API const char *config_table_name(ConfigTable *t);
+
+/***
+ * Start iterating over the pairs of a table in the order they appear in the configuration.
+ * The cursor is invalidated by config_reload(), config_reset(), config_reparse() and config_end().
+ *
+ * @param t A ConfigTable.
+ * @return A cursor for config_iter_next().
+ ***/
+CONFIG_PARSER_API ConfigIter config_table_iter(ConfigTable *t);
+
+/***
+ * Get the next pair of a table.
+ *
+ * @param it A cursor returned by config_table_iter().
+ * @param key Set to the key of the pair. May be NULL.
+ * @param type Set to the type of the value. May be NULL.
+ * @param value Set to the value of the pair (with ok set to true). May be NULL.
+ * @return true if a pair was returned, false if there are no more pairs.
+ ***/
+CONFIG_PARSER_API bool config_iter_next(ConfigIter *it, const char **key, ConfigType *type, ConfigValue *value);
+
+/***
+ * Start iterating over the tables of a parsed configuration in the order they appear in it.
+ * The top-level table is always the first one. There are no tables after config_reset()
+ * or a failed config_reparse().
+ * The cursor is invalidated by config_reload(), config_reset(), config_reparse() and config_end().
+ *
+ * @param p An initialized ConfigParser.
+ * @return A cursor for config_tables_next().
+ ***/
+CONFIG_PARSER_API ConfigIter config_tables_iter(ConfigParser *p);
+
+/***
+ * Get the next table of a parsed configuration.
+ *
+ * @param it A cursor returned by config_tables_iter().
+ * @param table Set to the table. May be NULL.
+ * @param name Set to the name of the table. May be NULL.
+ * @return true if a table was returned, false if there are no more tables.
+ ***/
+CONFIG_PARSER_API bool config_tables_next(ConfigIter *it, ConfigTable **table, const char **name);
 
 /***
  * Get a string value using 'key' from a table.
@@ -71,7 +290,7 @@ ConfigTable *config_get_table(ConfigParser *p, const char *name);
  * @param key The key to get the value from.
  * @return The value with ok set to true on success, and false on failure.
  ***/
-ConfigValue config_get_string(ConfigTable *t, const char *key);
+CONFIG_PARSER_API ConfigValue config_get_string(ConfigTable *t, const char *key);
 
 /***
  * Get a number value using 'key' from a table.
@@ -81,7 +300,7 @@ ConfigValue config_get_string(ConfigTable *t, const char *key);
  * @param key The key to get the value from.
  * @return The value with ok set to true on success, and false on failure.
  ***/
-ConfigValue config_get_number(ConfigTable *t, const char *key);
+CONFIG_PARSER_API ConfigValue config_get_number(ConfigTable *t, const char *key);
 
 /***
  * Get a boolean value using 'key' from a table.
@@ -91,7 +310,114 @@ ConfigValue config_get_number(ConfigTable *t, const char *key);
  * @param key The key to get the value from.
  * @return The value with ok set to true on success, and false on failure.
  ***/
-ConfigValue config_get_boolean(ConfigTable *t, const char *key);
+CONFIG_PARSER_API ConfigValue config_get_boolean(ConfigTable *t, const char *key);
+
+/***
+ * Get a datetime value using 'key' from a table.
+ * A local time (a time without a date) is the time on 1970-01-01, i.e. the time since midnight.
+ * errno is set to EINVAL if the key isn't found.
+ *
+ * @param t A ConfigTable.
+ * @param key The key to get the value from.
+ * @return The value (nanoseconds since the Unix epoch) with ok set to true on success, and false on failure.
+ ***/
+CONFIG_PARSER_API ConfigValue config_get_datetime(ConfigTable *t, const char *key);
+
+/***
+ * Get a duration value using 'key' from a table.
+ * errno is set to EINVAL if the key isn't found.
+ *
+ * @param t A ConfigTable.
+ * @param key The key to get the value from.
+ * @return The value (nanoseconds) with ok set to true on success, and false on failure.
+ ***/
+CONFIG_PARSER_API ConfigValue config_get_duration(ConfigTable *t, const char *key);
+
+/***
+ * Get a size value using 'key' from a table.
+ * errno is set to EINVAL if the key isn't found.
+ *
+ * @param t A ConfigTable.
+ * @param key The key to get the value from.
+ * @return The value (bytes) with ok set to true on success, and false on failure.
+ ***/
+CONFIG_PARSER_API ConfigValue config_get_size(ConfigTable *t, const char *key);
+
+/***
+ * Get the type of the value of 'key' in a table.
+ * Unlike the config_get_*() functions, errno isn't set if the key isn't found.
+ *
+ * @param t A ConfigTable.
+ * @param key The key.
+ * @return The type of the value, or CONFIG_TYPE_NONE if the key isn't found.
+ ***/
+CONFIG_PARSER_API ConfigType config_get_type(ConfigTable *t, const char *key);
+
+/***
+ * Get a string value using 'key' from a table, or a default value.
+ * errno isn't set.
+ *
+ * @param t A ConfigTable.
+ * @param key The key to get the value from.
+ * @param def The value returned if the key isn't found or its value isn't a string.
+ * @return The value or 'def'.
+ ***/
+CONFIG_PARSER_API const char *config_get_string_or(ConfigTable *t, const char *key, const char *def);
+
+/***
+ * Get a number value using 'key' from a table, or a default value.
+ * errno isn't set.
+ *
+ * @param t A ConfigTable.
+ * @param key The key to get the value from.
+ * @param def The value returned if the key isn't found or its value isn't a number.
+ * @return The value or 'def'.
+ ***/
+CONFIG_PARSER_API int64_t config_get_number_or(ConfigTable *t, const char *key, int64_t def);
+
+/***
+ * Get a boolean value using 'key' from a table, or a default value.
+ * errno isn't set.
+ *
+ * @param t A ConfigTable.
+ * @param key The key to get the value from.
+ * @param def The value returned if the key isn't found or its value isn't a boolean.
+ * @return The value or 'def'.
+ ***/
+CONFIG_PARSER_API bool config_get_boolean_or(ConfigTable *t, const char *key, bool def);
+
+/***
+ * Get a datetime value using 'key' from a table, or a default value.
+ * errno isn't set.
+ *
+ * @param t A ConfigTable.
+ * @param key The key to get the value from.
+ * @param def The value returned if the key isn't found or its value isn't a datetime.
+ * @return The value (nanoseconds since the Unix epoch) or 'def'.
+ ***/
+CONFIG_PARSER_API int64_t config_get_datetime_or(ConfigTable *t, const char *key, int64_t def);
+
+/***
+ * Get a duration value using 'key' from a table, or a default value.
+ * errno isn't set.
+ *
+ * @param t A ConfigTable.
+ * @param key The key to get the value from.
+ * @param def The value returned if the key isn't found or its value isn't a duration.
+ * @return The value (nanoseconds) or 'def'.
+ ***/
+CONFIG_PARSER_API int64_t config_get_duration_or(ConfigTable *t, const char *key, int64_t def);
+
+/***
+ * Get a size value using 'key' from a table, or a default value.
+ * errno isn't set.
+ *
+ * @param t A ConfigTable.
+ * @param key The key to get the value from.
+ * @param def The value returned if the key isn't found or its value isn't a size.
+ * @return The value (bytes) or 'def'.
+ ***/
+CONFIG_PARSER_API int64_t config_get_size_or(ConfigTable *t, const char *key, int64_t def);
 
 #ifdef __cplusplus
 }
@@ -0,0 +1,46 @@
+#ifndef HASH_H
+#define HASH_H
+
+#include <stddef.h> // size_t
+#include <stdint.h>
+
+// __extension__ keeps -Wpedantic quiet about the GCC/Clang 128-bit integer type.
+__extension__ typedef unsigned __int128 HashUint128;
+
+/***
+ * Hash a buffer (wyhash style, not cryptographic).
+ *
+ * @param data The buffer to hash.
+ * @param length The length of 'data'.
+ * @param seed A seed, different seeds give independent hashes.
+ * @return A 64 bit hash of the buffer.
+ ***/
+uint64_t hashBytes(const void *data, size_t length, uint64_t seed);
+
+/***
+ * Mix the bits of a 64 bit value.
+ *
+ * @param x A value.
+ * @return A well distributed 64 bit value.
+ ***/
+static inline uint64_t hashMix(uint64_t x) {
+    x ^= x >> 33;
+    x *= 0xff51afd7ed558ccdull;
+    x ^= x >> 33;
+    x *= 0xc4ceb9fe1a85ec53ull;
+    x ^= x >> 33;
+    return x;
+}
+
+/***
+ * Map a 64 bit hash to [0, n) without a division.
+ *
+ * @param hash A 64 bit hash.
+ * @param n The size of the range.
+ * @return A value in [0, n).
+ ***/
+static inline size_t hashReduce(uint64_t hash, size_t n) {
+    return (size_t)(((HashUint128)hash * n) >> 64);
+}
+
+#endif // HASH_H
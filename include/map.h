@@ -0,0 +1,31 @@
+#ifndef MAP_H
+#define MAP_H
+
+#include <stddef.h> // size_t
+#include <stdint.h>
+#include <stdbool.h>
+
+#define MAP_INITIAL_CAPACITY 16
+// mapClear() shrinks maps more than this many times larger than they need to be.
+#define MAP_SHRINK_FACTOR 4
+
+typedef struct map_entry {
+    const char *key; // NULL if the entry is empty.
+    uint64_t hash;
+    size_t value;
+} MapEntry;
+
+// A hash map from strings to indices. Keys are not copied.
+typedef struct map {
+    MapEntry *entries;
+    size_t used, capacity;
+} Map;
+
+void mapInit(Map *m);
+void mapInitCapacity(Map *m, size_t expected);
+void mapFree(Map *m);
+void mapClear(Map *m, size_t expected);
+bool mapGet(Map *m, const char *key, size_t *value);
+void mapSet(Map *m, const char *key, size_t value);
+
+#endif // MAP_H
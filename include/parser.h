@@ -4,12 +4,16 @@
 #include <stdint.h>
 #include <stdbool.h>
 #include "array.h"
+#include "arena.h"
 
 typedef enum literal_type {
     LIT_NONE,
     LIT_NUMBER,
     LIT_BOOLEAN,
-    LIT_STRING
+    LIT_STRING,
+    LIT_DATETIME,
+    LIT_DURATION,
+    LIT_SIZE
 } LiteralType;
 
 typedef struct literal {
@@ -18,6 +22,9 @@ typedef struct literal {
         int64_t number;
         bool boolean;
         char *string;
+        int64_t datetime; // nanoseconds since the Unix epoch
+        int64_t duration; // nanoseconds
+        int64_t size; // bytes
     } as;
 } Literal;
 
@@ -26,17 +33,16 @@ typedef struct config_pair {
     Literal value;
 } Pair;
 
-void free_literal(Literal l);
-
-void free_pair(Pair *p);
-
 /***
- * Populate a pair array from a config file source.
+ * Populate a table array from a config file source.
+ * The tables, their pairs and their strings are allocated from 'arena',
+ * and are freed with it (even if parsing fails).
  *
  * @param source The contents of a configuration file.
- * @param pairs A pointer to the table array to populate.
+ * @param tables A pointer to the table array to populate.
+ * @param arena The Arena to allocate the tables from.
  * @return true on success, false on failure.
  ***/
-bool config_parser_parse(char *source, Array *tables);
+bool config_parser_parse(char *source, Array *tables, Arena *arena);
 
 #endif // CONFIG_PARSER_H
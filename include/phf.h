@@ -0,0 +1,63 @@
+#ifndef PHF_H
+#define PHF_H
+
+#include <stddef.h> // size_t
+#include <stdint.h>
+#include <stdbool.h>
+#include "hash.h"
+
+// The average number of keys per bucket.
+#define PHF_BUCKET_SIZE 2
+// Keys are placed in 5% more slots than there are keys, as filling
+// the last free slots of a full table takes most of the build time
+// (with 1% the displacement search tries a third more slots).
+// The keys in the extra slots are moved to the free slots to make the function minimal.
+#define PHF_EXTRA_SLOTS(size) ((size) / 20 + 1)
+
+// A minimal perfect hash function built with hash and displace (CHD):
+// every key is hashed into a bucket, and every bucket has a displacement
+// that moves all of its keys into free slots.
+typedef struct phf {
+    uint64_t seed;
+    size_t size; // the number of keys, and of slots.
+    size_t bucket_count;
+    uint32_t *displacements; // one per bucket.
+    uint32_t *remap; // the final slot of the keys placed in the extra slots.
+} Phf;
+
+/***
+ * Build a minimal perfect hash function.
+ *
+ * @param phf The Phf to build.
+ * @param keys The keys, which have to be distinct.
+ * @param count The number of keys.
+ * @param key_slots An array of 'count' slots, set to the slot of every key (as phfLookup() returns it).
+ * @return true on success, false if memory couldn't be allocated.
+ ***/
+bool phfBuild(Phf *phf, const char **keys, size_t count, size_t *key_slots);
+
+/***
+ * Free a Phf.
+ *
+ * @param phf A Phf built with phfBuild().
+ ***/
+void phfFree(Phf *phf);
+
+/***
+ * Get the slot of a key.
+ * Keys that weren't used to build the function are mapped to some slot as well,
+ * so the key in the slot has to be compared with 'key'.
+ *
+ * @param phf A Phf built with phfBuild() with at least one key.
+ * @param key The key.
+ * @param length The length of the key.
+ * @return A slot in [0, phf->size).
+ ***/
+static inline size_t phfLookup(const Phf *phf, const char *key, size_t length) {
+    uint64_t hash = hashBytes(key, length, phf->seed);
+    uint32_t displacement = phf->displacements[hashReduce(hash, phf->bucket_count)];
+    size_t slot = hashReduce(hashMix(hash ^ ((uint64_t)displacement * 0x9e3779b97f4a7c15ull)), phf->size + PHF_EXTRA_SLOTS(phf->size));
+    return slot < phf->size ? slot : phf->remap[slot - phf->size];
+}
+
+#endif // PHF_H
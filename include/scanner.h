@@ -2,16 +2,23 @@
 #define SCANNER_H
 
 #include <stddef.h>
+#include <stdbool.h>
 #include "token.h"
 
 typedef struct scanner {
     char *source;
-    int line;
+    size_t length;
     size_t start, current;
+    bool had_error; // set when an error is reported.
+    // the last position passed to scannerLine() and its line, errors are
+    // mostly reported in order so the next line is counted from there.
+    size_t line_at;
+    int line;
 } Scanner;
 
 /***
  * Initialize a Scanner.
+ * Token positions are 32-bit, so the source has to be shorter than 4 GiB.
  * 
  * @param s A Scanner to initialize.
  * @param source The source.
@@ -33,4 +40,28 @@ void scannerFree(Scanner *s);
  ***/
 Token scannerNextToken(Scanner *s);
 
+/***
+ * Scan a batch of tokens.
+ * Error tokens are reported but not stored (had_error is set instead),
+ * so the batch is the token stream of scannerNextToken() without them.
+ * The batch ends after the EOF token, which is returned again by every following call.
+ *
+ * @param s An initialized Scanner.
+ * @param tokens The tokens.
+ * @param capacity The size of 'tokens', at least 1.
+ * @return The number of tokens stored in 'tokens'.
+ ***/
+size_t scannerScan(Scanner *s, Token *tokens, size_t capacity);
+
+/***
+ * Compute the line of a position in the source.
+ * Lines are only needed for error messages, so they aren't tracked while scanning.
+ * Only the newlines between 'at' and the previous position are counted.
+ *
+ * @param s An initialized Scanner.
+ * @param at A position in the source.
+ * @return The line (starting at 1).
+ ***/
+int scannerLine(Scanner *s, size_t at);
+
 #endif // SCANNER_H
@@ -0,0 +1,74 @@
+#ifndef SNAPSHOT_H
+#define SNAPSHOT_H
+
+// An on-disk cache of parsed files: the tables parsed from a file are saved in a snapshot
+// named after the hash of the file's absolute path, so that processes that parse the same
+// file later load its tables from the snapshot instead of scanning and parsing it again,
+// and the snapshot of a file that changed replaces the previous one.
+// A snapshot also holds the path of the file and the device, inode, size, mtime and a hash of the
+// contents of the version it was made from, which have to match the file's, and is only used from
+// a directory that only the user of the process can write to.
+
+#include <stddef.h> // size_t
+#include <stdint.h>
+#include <stdbool.h>
+#include <sys/stat.h>
+#include "array.h"
+#include "arena.h"
+
+// The seed of the hash of the absolute paths of the files (hashBytes()), which names their snapshots.
+#define SNAPSHOT_SEED 0x736e617073686f74ull
+
+/***
+ * Open the cache directory if it can be trusted:
+ * it has to be owned by the effective user and not be writable by its group or others.
+ * sets errno (EACCES if the directory can't be trusted).
+ *
+ * @param dir The cache directory.
+ * @return A descriptor of the directory, or -1 on failure.
+ ***/
+int snapshotOpenDir(const char *dir);
+
+/***
+ * Load the tables of a file from its snapshot.
+ * Snapshots that are missing, were written by another version of the library, are corrupt,
+ * weren't made from the same path and version of the file, or are in a directory that can't
+ * be trusted are ignored.
+ *
+ * @param dir The cache directory.
+ * @param path The path of the file, relative to the current directory if it isn't absolute.
+ * @param file The status of the file.
+ * @param contents The contents of the file.
+ * @param length The length of the contents of the file.
+ * @param tables An empty Array<ConfigTable *> allocated from 'arena', the tables are pushed to it.
+ * @param arena The Arena to allocate the tables from.
+ * @return true if the tables were loaded, false if the file has to be parsed.
+ ***/
+bool snapshotLoad(const char *dir, const char *path, const struct stat *file, const char *contents, size_t length, Array *tables, Arena *arena);
+
+/***
+ * Save the tables parsed from a file in a snapshot.
+ * The snapshot is written to a temporary file that is renamed,
+ * so other processes never see a partial snapshot. Errors are ignored.
+ * The snapshot gets the permissions of the file, so it isn't more readable.
+ *
+ * @param dir The cache directory.
+ * @param path The path of the file, relative to the current directory if it isn't absolute.
+ * @param file The status of the file.
+ * @param contents The contents of the file.
+ * @param length The length of the contents of the file.
+ * @param tables The tables parsed from the file (Array<ConfigTable *>).
+ ***/
+void snapshotWrite(const char *dir, const char *path, const struct stat *file, const char *contents, size_t length, Array *tables);
+
+/***
+ * Remove the temporary files that writers which died left in the cache directory,
+ * and the snapshots that are invalid or whose file no longer exists.
+ * sets errno.
+ *
+ * @param dir The cache directory.
+ * @return true on success, false if the directory can't be opened or trusted.
+ ***/
+bool snapshotPrune(const char *dir);
+
+#endif // SNAPSHOT_H
@@ -4,6 +4,7 @@
 #include <stdio.h>
 #include <stdint.h>
 #include <stddef.h> // size_t
+#include <stdbool.h>
 
 // Update tokenPrint(), tokenTypeString() and token_type_name() in Token.c when adding new token types.
 typedef enum token_type {
@@ -14,6 +15,10 @@ typedef enum token_type {
 
     // Literals
     TK_NUMBER,
+    // the value of these is stored in 'number' as well.
+    TK_DATETIME, // nanoseconds since the Unix epoch
+    TK_DURATION, // nanoseconds
+    TK_SIZE,     // bytes
     TK_TRUE,
     TK_FALSE,
     TK_STRING,
@@ -27,15 +32,23 @@ typedef enum token_type {
 } TokenType;
 
 
+// Set in Token.flags of strings that have to be unescaped.
+#define TOKEN_HAS_ESCAPES 0x1
+
+// Tokens are kept small (16 bytes) so the parser can buffer them cheaply:
+// positions are 32-bit offsets into the source, and the line of a token
+// is only computed (with scannerLine()) when an error is reported.
 typedef struct token {
-    TokenType type;
-    int line, at;
+    uint32_t at; // the offset of the first character.
+    uint8_t type; // TokenType
+    uint8_t flags; // TOKEN_HAS_ESCAPES
     union {
         int64_t number;
+        // strings and identifiers: the offset and length of their text in the source
+        // (without the quotes for strings).
         struct {
-            char *txt;
-            size_t length;
-        } string_or_id;
+            uint32_t start, length;
+        } slice;
     } as;
 } Token;
 
@@ -43,11 +56,10 @@ typedef struct token {
  * Make a new base Token.
  *
  * @param type A TokenType.
- * @param line The line in which the token occurs.
  * @param at The first character's location.
  * @return A new base Token.
  ***/
-Token tokenNew(TokenType type, int line, int at);
+Token tokenNew(TokenType type, uint32_t at);
 
 /***
  * Return the equivalent of a TokenType as a string.
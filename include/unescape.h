@@ -0,0 +1,17 @@
+#ifndef UNESCAPE_H
+#define UNESCAPE_H
+
+#include <stddef.h> // size_t
+
+/***
+ * Decode the escape sequences of a basic string.
+ * The escape sequences must have already been validated by the scanner.
+ *
+ * @param src The contents of the string without the quotes.
+ * @param length The length of 'src'.
+ * @param dest A buffer of at least 'length' + 1 bytes. The result is NUL terminated.
+ * @return The length of the decoded string.
+ ***/
+size_t unescapeString(const char *src, size_t length, char *dest);
+
+#endif // UNESCAPE_H
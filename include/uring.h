@@ -0,0 +1,78 @@
+#ifndef URING_H
+#define URING_H
+
+// A minimal io_uring interface on top of the raw system calls (Linux only).
+
+#if defined(__linux__) && !defined(CONFIG_PARSER_NO_IO_URING)
+#define HAVE_IO_URING
+
+#include <stddef.h> // size_t
+#include <linux/io_uring.h>
+
+typedef struct uring {
+    int fd;
+    // submission queue
+    unsigned *sq_head, *sq_tail, *sq_mask, *sq_array;
+    struct io_uring_sqe *sqes;
+    unsigned sq_entries;
+    unsigned to_submit; // the number of entries queued since the last uringSubmit().
+    // completion queue
+    unsigned *cq_head, *cq_tail, *cq_mask;
+    struct io_uring_cqe *cqes;
+    // the mappings of the rings.
+    void *sq_ring, *cq_ring;
+    size_t sq_ring_size, cq_ring_size, sqes_size;
+} Uring;
+
+/***
+ * Set up an io_uring.
+ *
+ * @param u The Uring to initialize.
+ * @param entries The size of the submission queue.
+ * @return 0 on success, a negative errno value on failure
+ *         (-ENOSYS or -EPERM if io_uring isn't available).
+ ***/
+int uringInit(Uring *u, unsigned entries);
+
+/***
+ * Tear down an io_uring.
+ *
+ * @param u A Uring initialized with uringInit().
+ ***/
+void uringFree(Uring *u);
+
+/***
+ * Get a free submission queue entry, which is submitted by the next uringSubmit().
+ *
+ * @param u A Uring.
+ * @return A zeroed entry, or NULL if the submission queue is full.
+ ***/
+struct io_uring_sqe *uringGetSqe(Uring *u);
+
+/***
+ * Submit the queued entries and wait for completions.
+ *
+ * @param u A Uring.
+ * @param wait The number of completions to wait for.
+ * @return The number of entries submitted, or a negative errno value.
+ ***/
+int uringSubmit(Uring *u, unsigned wait);
+
+/***
+ * Get the next completion without waiting.
+ *
+ * @param u A Uring.
+ * @return The completion, which has to be released with uringSeen(), or NULL if there is none.
+ ***/
+struct io_uring_cqe *uringPeek(Uring *u);
+
+/***
+ * Release the completion returned by uringPeek().
+ *
+ * @param u A Uring.
+ ***/
+void uringSeen(Uring *u);
+
+#endif // __linux__ && !CONFIG_PARSER_NO_IO_URING
+
+#endif // URING_H
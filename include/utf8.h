@@ -0,0 +1,35 @@
+#ifndef UTF8_H
+#define UTF8_H
+
+#include <stddef.h> // size_t
+#include <stdint.h>
+
+/***
+ * Encode a unicode scalar value as UTF-8.
+ *
+ * @param codepoint A unicode scalar value (not a surrogate and at most 0x10FFFF).
+ * @param out A buffer of at least 4 bytes to write the encoded sequence into.
+ * @return The number of bytes written.
+ ***/
+size_t utf8Encode(uint32_t codepoint, char *out);
+
+/***
+ * Validate a single multi-byte UTF-8 sequence.
+ *
+ * @param s The first byte of the sequence.
+ * @param remaining The number of bytes available starting at 's'.
+ * @return The length of the sequence or 0 if it isn't valid UTF-8.
+ ***/
+size_t utf8SequenceLength(const unsigned char *s, size_t remaining);
+
+/***
+ * Validate a UTF-8 buffer.
+ * Blocks of ASCII characters are skipped 16 bytes at a time when SSE2 is available.
+ *
+ * @param s The buffer to validate.
+ * @param length The length of 's'.
+ * @return 'length' if the buffer is valid or the offset of the first invalid byte.
+ ***/
+size_t utf8Validate(const char *s, size_t length);
+
+#endif // UTF8_H
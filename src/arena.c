@@ -0,0 +1,91 @@
+#include <stdlib.h>
+#include <string.h> // memcpy, memset
+#include <stddef.h> // max_align_t
+#include "arena.h"
+
+#define ALIGNMENT _Alignof(max_align_t)
+
+// the data of a block starts at the first aligned address after the block header.
+#define HEADER_SIZE ((sizeof(ArenaBlock) + ALIGNMENT - 1) & ~(ALIGNMENT - 1))
+
+static ArenaBlock *new_block(size_t size) {
+    ArenaBlock *block = malloc(HEADER_SIZE + size);
+    if(!block) {
+        return NULL;
+    }
+    block->next = NULL;
+    block->data = (char *)block + HEADER_SIZE;
+    block->size = size;
+    block->used = 0;
+    return block;
+}
+
+void arenaInit(Arena *a) {
+    a->blocks = NULL;
+}
+
+void arenaFree(Arena *a) {
+    ArenaBlock *block = a->blocks;
+    while(block) {
+        ArenaBlock *next = block->next;
+        free(block);
+        block = next;
+    }
+    a->blocks = NULL;
+}
+
+void arenaReset(Arena *a) {
+    if(!a->blocks) {
+        return;
+    }
+    if(!a->blocks->next) {
+        a->blocks->used = 0;
+        return;
+    }
+    size_t total = 0;
+    for(ArenaBlock *block = a->blocks; block; block = block->next) {
+        total += block->size;
+    }
+    arenaFree(a);
+    // if this fails the next allocation gets a new block.
+    a->blocks = new_block(total);
+}
+
+void *arenaAlloc(Arena *a, size_t size) {
+    size = (size + ALIGNMENT - 1) & ~(ALIGNMENT - 1);
+    ArenaBlock *block = a->blocks;
+    if(!block || block->size - block->used < size) {
+        // the blocks grow so that a large arena only has a few of them.
+        size_t block_size = block ? block->size * 2 : ARENA_BLOCK_SIZE;
+        if(block_size < size) {
+            block_size = size;
+        }
+        block = new_block(block_size);
+        if(!block) {
+            return NULL;
+        }
+        block->next = a->blocks;
+        a->blocks = block;
+    }
+    void *memory = block->data + block->used;
+    block->used += size;
+    return memory;
+}
+
+void *arenaCalloc(Arena *a, size_t size) {
+    void *memory = arenaAlloc(a, size);
+    if(memory) {
+        memset(memory, 0, size);
+    }
+    return memory;
+}
+
+char *arenaStrndup(Arena *a, const char *s, size_t length) {
+    char *copy = arenaAlloc(a, length + 1);
+    if(!copy) {
+        return NULL;
+    }
+    memcpy(copy, s, length);
+    copy[length] = '\0';
+    return copy;
+}
@@ -1,22 +1,52 @@
 #include <stdlib.h>
+#include <string.h> // memcpy
+#include "arena.h"
 #include "array.h"
 
 void arrayInit(Array *a) {
     a->used = 0;
     a->capacity = ARRAY_INITIAL_CAPACITY;
     a->data = calloc(a->capacity, sizeof(void *));
+    a->arena = NULL;
+}
+
+void arrayInitArena(Array *a, Arena *arena) {
+    a->used = 0;
+    a->capacity = ARRAY_INITIAL_CAPACITY;
+    a->data = arenaAlloc(arena, a->capacity * sizeof(void *));
+    a->arena = arena;
+}
+
+void arrayInitArenaCapacity(Array *a, Arena *arena, size_t capacity) {
+    a->used = 0;
+    a->capacity = capacity > ARRAY_INITIAL_CAPACITY ? capacity : ARRAY_INITIAL_CAPACITY;
+    a->data = arenaAlloc(arena, a->capacity * sizeof(void *));
+    a->arena = arena;
 }
 
 void arrayFree(Array *a) {
-    free(a->data);
+    if(!a->arena) {
+        free(a->data);
+    }
     a->data = NULL;
     a->used = a->capacity = 0;
 }
 
+void arrayClear(Array *a) {
+    a->used = 0;
+}
+
 int arrayPush(Array *a, void *value) {
     if(a->used + 1 > a->capacity) {
         a->capacity *= 2;
-        a->data = realloc(a->data, sizeof(void *) * a->capacity);
+        if(a->arena) {
+            // the old data stays in the arena until it is reset.
+            void **data = arenaAlloc(a->arena, sizeof(void *) * a->capacity);
+            memcpy(data, a->data, sizeof(void *) * a->used);
+            a->data = data;
+        } else {
+            a->data = realloc(a->data, sizeof(void *) * a->capacity);
+        }
     }
     a->data[a->used++] = value;
     return a->used - 1;
@@ -30,7 +60,7 @@ void *arrayPop(Array *a) {
 }
 
 void *arrayGet(Array *a, int index) {
-    if((size_t)index > a->used) {
+    if(index < 0 || (size_t)index >= a->used) {
         return NULL;
     }
     return a->data[index];
@@ -0,0 +1,424 @@
+#include <stdlib.h>
+#include <string.h> // memset
+#include <stdint.h> // uintptr_t
+#include <stdbool.h>
+#include <errno.h>
+#include <fcntl.h> // O_RDONLY, AT_FDCWD
+#include <unistd.h> // close, sysconf
+#include <pthread.h>
+#include <sys/stat.h>
+#include "config_internal.h"
+#include "uring.h"
+
+#ifdef HAVE_IO_URING
+#include <sys/sysmacros.h> // makedev
+#include <linux/stat.h> // struct statx
+
+#ifndef AT_EMPTY_PATH
+#define AT_EMPTY_PATH 0x1000
+#endif
+#endif
+
+#define DEFAULT_QUEUE_DEPTH 64
+
+typedef struct batch {
+    const char **paths;
+    ConfigParser *parsers;
+    size_t count;
+    int *errors; // may be NULL.
+    size_t parsed;
+    pthread_mutex_t lock;
+    pthread_cond_t ready;
+    // the files that were read and can be parsed.
+    size_t *queue;
+    size_t queue_head, queue_tail;
+    bool reading_done; // no file will be added to the queue anymore.
+    // set if the threads read the files themselves, in that order.
+    bool blocking;
+    size_t next_file;
+} Batch;
+
+static void parse_file(Batch *b, size_t i) {
+    ConfigParser *p = &b->parsers[i];
+    if(!p->pool) {
+        // config_init_parser() failed.
+        return;
+    }
+    ConfigTable *top_level = config_load(p, b->paths[i]);
+    int error = errno;
+    if(!top_level) {
+        config_end(p);
+    }
+    pthread_mutex_lock(&b->lock);
+    if(b->errors) {
+        b->errors[i] = top_level ? 0 : error;
+    }
+    b->parsed += top_level != NULL;
+    pthread_mutex_unlock(&b->lock);
+}
+
+static void *parse_files(void *batch) {
+    Batch *b = (Batch *)batch;
+    for(;;) {
+        size_t i;
+        pthread_mutex_lock(&b->lock);
+        while(!b->blocking && b->queue_head == b->queue_tail && !b->reading_done) {
+            pthread_cond_wait(&b->ready, &b->lock);
+        }
+        if(b->blocking) {
+            i = b->next_file++;
+            pthread_mutex_unlock(&b->lock);
+            if(i >= b->count) {
+                return NULL;
+            }
+            parse_file(b, i);
+            continue;
+        }
+        if(b->queue_head == b->queue_tail) {
+            pthread_mutex_unlock(&b->lock);
+            return NULL;
+        }
+        i = b->queue[b->queue_head++];
+        pthread_mutex_unlock(&b->lock);
+        parse_file(b, i);
+    }
+}
+
+static void queue_file(Batch *b, size_t i) {
+    pthread_mutex_lock(&b->lock);
+    b->queue[b->queue_tail++] = i;
+    pthread_cond_signal(&b->ready);
+    pthread_mutex_unlock(&b->lock);
+}
+
+#ifdef HAVE_IO_URING
+
+enum read_stage {
+    STAGE_OPEN,
+    STAGE_STAT,
+    STAGE_READ
+};
+
+// The state of a file read with io_uring.
+typedef struct file_read {
+    enum read_stage stage;
+    bool queued; // the file was handed to the parsing threads.
+    int fd;
+    size_t done; // the number of bytes read.
+    struct statx stx;
+} FileRead;
+
+static struct io_uring_sqe *get_sqe(Uring *u) {
+    struct io_uring_sqe *sqe;
+    // every file has at most one entry queued and there are at most as many files
+    // in flight as entries, so the queue is only full if the kernel didn't consume it yet.
+    while(!(sqe = uringGetSqe(u))) {
+        uringSubmit(u, 0);
+    }
+    return sqe;
+}
+
+static void submit_read(Uring *u, FileRead *r, size_t i, char *buffer) {
+    struct io_uring_sqe *sqe = get_sqe(u);
+    sqe->opcode = IORING_OP_READ;
+    sqe->fd = r->fd;
+    sqe->addr = (uintptr_t)(buffer + r->done);
+    sqe->len = (unsigned)(r->stx.stx_size - r->done);
+    sqe->off = r->done;
+    sqe->user_data = i;
+}
+
+// Hand a file that was read to the parsing threads.
+static void file_read(Batch *b, FileRead *r, size_t i) {
+    close(r->fd);
+    ConfigPool *pool = b->parsers[i].pool;
+    pool->buffer[r->done] = '\0';
+    struct stat *st = &pool->preloaded_stat;
+    memset(st, 0, sizeof(*st));
+    st->st_dev = makedev(r->stx.stx_dev_major, r->stx.stx_dev_minor);
+    st->st_ino = r->stx.stx_ino;
+    st->st_mode = r->stx.stx_mode;
+    st->st_size = r->stx.stx_size;
+    st->st_mtim.tv_sec = r->stx.stx_mtime.tv_sec;
+    st->st_mtim.tv_nsec = r->stx.stx_mtime.tv_nsec;
+    pool->preloaded = true;
+    r->queued = true;
+    queue_file(b, i);
+}
+
+// Move a file to the next stage of its read.
+// returns false when the file left the ring.
+static bool advance_read(Batch *b, Uring *u, FileRead *r, size_t i, int result) {
+    ConfigPool *pool = b->parsers[i].pool;
+    switch(r->stage) {
+        case STAGE_OPEN: {
+            if(result < 0) {
+                break;
+            }
+            r->fd = result;
+            r->stage = STAGE_STAT;
+            struct io_uring_sqe *sqe = get_sqe(u);
+            sqe->opcode = IORING_OP_STATX;
+            sqe->fd = r->fd;
+            sqe->addr = (uintptr_t)"";
+            sqe->len = STATX_BASIC_STATS;
+            sqe->statx_flags = AT_EMPTY_PATH;
+            sqe->off = (uintptr_t)&r->stx;
+            sqe->user_data = i;
+            return true;
+        }
+        case STAGE_STAT:
+            if(result < 0 || !S_ISREG(r->stx.stx_mode)) {
+                close(r->fd);
+                break;
+            }
+            if(r->stx.stx_size + 1 > pool->buffer_capacity) {
+                char *buffer = realloc(pool->buffer, r->stx.stx_size + 1);
+                if(!buffer) {
+                    close(r->fd);
+                    break;
+                }
+                pool->buffer = buffer;
+                pool->buffer_capacity = r->stx.stx_size + 1;
+            }
+            r->stage = STAGE_READ;
+            r->done = 0;
+            if(r->stx.stx_size == 0) {
+                file_read(b, r, i);
+                return false;
+            }
+            submit_read(u, r, i, pool->buffer);
+            return true;
+        case STAGE_READ:
+            if(result == -EINTR || result == -EAGAIN) {
+                submit_read(u, r, i, pool->buffer);
+                return true;
+            }
+            if(result < 0) {
+                close(r->fd);
+                break;
+            }
+            r->done += result;
+            // a short read that isn't the end of the file (which was truncated after statx).
+            if(result > 0 && r->done < r->stx.stx_size) {
+                submit_read(u, r, i, pool->buffer);
+                return true;
+            }
+            file_read(b, r, i);
+            return false;
+    }
+    // the file is read again with blocking I/O by config_load(), which reports the error.
+    r->queued = true;
+    queue_file(b, i);
+    return false;
+}
+
+// The user_data of cancellations, files use their index.
+#define CANCEL_USER_DATA UINT64_MAX
+
+// Cancel the operations of the files in the ring and wait for them to complete, after
+// io_uring_enter() failed, so the kernel doesn't write to the buffers of the files or to
+// 'reads' after they are reused.
+// returns the number of operations still in flight if waiting for them failed as well.
+static size_t cancel_reads(Batch *b, Uring *u, FileRead *reads, size_t next, size_t in_flight) {
+    for(size_t i = 0; i < next; ++i) {
+        if(!b->parsers[i].pool || reads[i].queued) {
+            continue;
+        }
+        // if the queue is full, the remaining operations complete on their own.
+        struct io_uring_sqe *sqe = uringGetSqe(u);
+        if(!sqe) {
+            break;
+        }
+        sqe->opcode = IORING_OP_ASYNC_CANCEL;
+        sqe->addr = i;
+        sqe->user_data = CANCEL_USER_DATA;
+    }
+    while(in_flight > 0) {
+        if(uringSubmit(u, 1) < 0) {
+            return in_flight;
+        }
+        struct io_uring_cqe *cqe;
+        while((cqe = uringPeek(u))) {
+            uint64_t i = cqe->user_data;
+            int res = cqe->res;
+            uringSeen(u);
+            if(i == CANCEL_USER_DATA) {
+                continue;
+            }
+            // the operation is over, whether it was cancelled or not.
+            FileRead *r = &reads[i];
+            if(r->stage != STAGE_OPEN) {
+                close(r->fd);
+            } else if(res >= 0) {
+                close(res);
+            }
+            in_flight--;
+        }
+    }
+    return 0;
+}
+
+// Read the files with io_uring and queue them for the parsing threads as their reads complete.
+// returns false if io_uring isn't available.
+static bool read_files(Batch *b, unsigned queue_depth) {
+    Uring u;
+    if(uringInit(&u, queue_depth) < 0) {
+        return false;
+    }
+    FileRead *reads = calloc(b->count, sizeof(*reads));
+    if(!reads) {
+        uringFree(&u);
+        return false;
+    }
+
+    size_t next = 0, in_flight = 0;
+    while(next < b->count || in_flight > 0) {
+        while(next < b->count && in_flight < u.sq_entries) {
+            size_t i = next++;
+            if(!b->parsers[i].pool) {
+                // config_init_parser() failed.
+                continue;
+            }
+            struct io_uring_sqe *sqe = get_sqe(&u);
+            sqe->opcode = IORING_OP_OPENAT;
+            sqe->fd = AT_FDCWD;
+            sqe->addr = (uintptr_t)b->paths[i];
+            sqe->open_flags = O_RDONLY | O_CLOEXEC;
+            sqe->user_data = i;
+            reads[i].stage = STAGE_OPEN;
+            in_flight++;
+        }
+        if(in_flight == 0) {
+            break;
+        }
+        if(uringSubmit(&u, 1) < 0) {
+            break;
+        }
+        struct io_uring_cqe *cqe;
+        while((cqe = uringPeek(&u))) {
+            size_t i = (size_t)cqe->user_data;
+            int res = cqe->res;
+            uringSeen(&u);
+            if(!advance_read(b, &u, &reads[i], i, res)) {
+                in_flight--;
+            }
+        }
+    }
+    bool failed = next < b->count || in_flight > 0;
+    if(failed) {
+        in_flight = cancel_reads(b, &u, reads, next, in_flight);
+    }
+    uringFree(&u);
+
+    pthread_mutex_lock(&b->lock);
+    if(failed) {
+        // io_uring_enter() failed, which shouldn't happen: the files that weren't handed to
+        // the parsing threads are read again with blocking I/O. If the cancelled operations
+        // couldn't be waited for, the kernel may still write to the buffers of the files
+        // that were in flight, so these buffers (and descriptors) are leaked.
+        for(size_t i = 0; i < b->count; ++i) {
+            ConfigPool *pool = b->parsers[i].pool;
+            if(!pool || reads[i].queued) {
+                continue;
+            }
+            if(in_flight > 0 && i < next) {
+                pool->buffer = NULL;
+                pool->buffer_capacity = 0;
+            }
+            b->queue[b->queue_tail++] = i;
+        }
+    }
+    free(reads);
+    b->reading_done = true;
+    pthread_cond_broadcast(&b->ready);
+    pthread_mutex_unlock(&b->lock);
+    return true;
+}
+
+#endif // HAVE_IO_URING
+
+size_t config_parse_many(const char **paths, size_t n, ConfigParser *parsers, const ConfigParseOptions *opts) {
+    ConfigParseOptions defaults = {0};
+    if(!opts) {
+        opts = &defaults;
+    }
+    Batch b = {
+        .paths = paths,
+        .parsers = parsers,
+        .count = n,
+        .errors = opts->errors,
+        .parsed = 0,
+        .queue = malloc(n * sizeof(size_t)),
+        .queue_head = 0,
+        .queue_tail = 0,
+        .reading_done = false,
+        .blocking = true,
+        .next_file = 0
+    };
+    if(n == 0 || !b.queue) {
+        for(size_t i = 0; i < n; ++i) {
+            parsers[i] = (ConfigParser){0};
+            if(b.errors) {
+                b.errors[i] = ENOMEM;
+            }
+        }
+        free(b.queue);
+        return 0;
+    }
+    for(size_t i = 0; i < n; ++i) {
+        // a parser that can't be initialized is skipped by the reads and the parsing threads.
+        int error = 0;
+        if(!config_init_parser(&parsers[i])) {
+            error = errno;
+        } else if(!config_set_options(&parsers[i], opts)) {
+            error = errno;
+            config_end(&parsers[i]);
+        }
+        if(b.errors) {
+            b.errors[i] = error;
+        }
+    }
+    pthread_mutex_init(&b.lock, NULL);
+    pthread_cond_init(&b.ready, NULL);
+
+    long threads = opts->threads > 0 ? opts->threads : sysconf(_SC_NPROCESSORS_ONLN);
+    if(threads < 1) {
+        threads = 1;
+    }
+    if((size_t)threads > n) {
+        threads = (long)n;
+    }
+#ifdef HAVE_IO_URING
+    b.blocking = opts->no_io_uring;
+#endif
+    // this thread is one of the parsing threads, with io_uring it reads the files first.
+    pthread_t *workers = malloc(threads * sizeof(*workers));
+    long started = 0;
+    while(workers && started < threads - 1 &&
+          pthread_create(&workers[started], NULL, parse_files, &b) == 0) {
+        started++;
+    }
+#ifdef HAVE_IO_URING
+    if(!b.blocking) {
+        unsigned queue_depth = opts->queue_depth > 0 ? (unsigned)opts->queue_depth : DEFAULT_QUEUE_DEPTH;
+        if(!read_files(&b, queue_depth)) {
+            // io_uring isn't available.
+            pthread_mutex_lock(&b.lock);
+            b.blocking = true;
+            pthread_cond_broadcast(&b.ready);
+            pthread_mutex_unlock(&b.lock);
+        }
+    }
+#endif
+    parse_files(&b);
+    for(long i = 0; i < started; ++i) {
+        pthread_join(workers[i], NULL);
+    }
+    free(workers);
+
+    pthread_cond_destroy(&b.ready);
+    pthread_mutex_destroy(&b.lock);
+    free(b.queue);
+    return b.parsed;
+}
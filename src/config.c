@@ -1,106 +1,892 @@
 #include <stdio.h>
 #include <stdlib.h>
-#include <string.h> // strdup
+#include <string.h> // strcmp, memcpy
+#include <stdarg.h>
 #include <errno.h>
 #include <stdbool.h>
+#include <fcntl.h> // open
+#include <unistd.h> // read, close
+#include <sys/stat.h>
 #include "array.h"
+#include "arena.h"
+#include "map.h"
+#include "hash.h"
 #include "parser.h"
 #include "config_internal.h"
+#include "config_inline.h"
+#include "snapshot.h"
+
+#define TOPLEVEL_TABLE_NAME "__toplevel__"
+#define INCLUDE_KEY "include"
 
 /* helpers */
 
+static void file_error(const char *path, const char *format, ...) {
+    va_list ap;
+    fprintf(stderr, "[%s] Error: ", path);
+    va_start(ap, format);
+    vfprintf(stderr, format, ap);
+    va_end(ap);
+    fputc('\n', stderr);
+}
+
+// Copy 's' into a buffer that only grows.
 // sets errno.
-// the returned buffer has to be freed (with free()).
-static char *read_file(const char *path) {
-    FILE *fp = fopen(path, "r");
-    if(!fp) {
-        // errno is set by fopen().
-        return NULL;
+static char *copy_string(char **buffer, size_t *capacity, const char *s) {
+    size_t length = strlen(s);
+    if(*buffer == s) {
+        return *buffer;
+    }
+    if(length + 1 > *capacity) {
+        char *grown = realloc(*buffer, length + 1);
+        if(!grown) {
+            // errno is set by realloc().
+            return NULL;
+        }
+        *buffer = grown;
+        *capacity = length + 1;
     }
+    memcpy(*buffer, s, length + 1);
+    return *buffer;
+}
 
-    // FIXME: This isn't portable. SEEK_END is optional according to posix.
-    fseek(fp, 0, SEEK_END);
-    size_t length = ftell(fp);
-    rewind(fp);
+// Read a file into the pool's buffer.
+// sets errno.
+static char *read_file(ConfigPool *pool, int fd, size_t length) {
+    if(length + 1 > pool->buffer_capacity) {
+        char *buffer = realloc(pool->buffer, length + 1);
+        if(!buffer) {
+            // errno is set by realloc().
+            return NULL;
+        }
+        pool->buffer = buffer;
+        pool->buffer_capacity = length + 1;
+    }
+    char *buffer = pool->buffer;
+    size_t total = 0;
+    while(total < length) {
+        ssize_t n = read(fd, buffer + total, length - total);
+        if(n < 0) {
+            if(errno == EINTR) {
+                continue;
+            }
+            // errno is set by read().
+            return NULL;
+        }
+        if(n == 0) {
+            // the file was truncated after fstat().
+            break;
+        }
+        total += n;
+    }
+    buffer[total] = '\0';
+    return buffer;
+}
 
-    char *buffer = calloc(length + 1, sizeof(char));
-    if(!buffer) {
-        // errno is set by calloc().
-        fclose(fp);
-        return false;
+static void unfreeze_table(ConfigTable *t) {
+    if(t->slots) {
+        phfFree(&t->phf);
+        free(t->slots);
+        t->slots = NULL;
     }
-    // TODO: check that fread read 'length' bytes.
-    fread(buffer, sizeof(char), length, fp);
-    buffer[length] = '\0';
+}
 
-    fclose(fp);
-    return buffer;
+// The tables are allocated from an arena, only the perfect hashes of frozen tables have to be freed.
+static void unfreeze_tables(Array *tables) {
+    for(size_t i = 0; i < tables->used; ++i) {
+        unfreeze_table(ARRAY_GET_AS(ConfigTable *, tables, i));
+    }
 }
 
-static void free_pair_callback(void *pair, void *cl) {
-    (void)cl; // unused
-    Pair *p = (Pair *)pair;
-    free_pair(p);
+static void free_file(ConfigFile *f) {
+    arenaFree(&f->arenas[0]);
+    arenaFree(&f->arenas[1]);
+    free(f->path);
+    free(f);
 }
 
-static void free_table(ConfigTable *t) {
-    arrayMap(&t->pairs, free_pair_callback, NULL);
-    arrayFree(&t->pairs);
-    free(t->name);
-    free(t);
+static void free_file_callback(void *file, void *cl) {
+    (void)cl; // unused
+    free_file((ConfigFile *)file);
 }
 
-static void free_table_callback(void *table, void *cl) {
+static void free_map_callback(void *map, void *cl) {
     (void)cl; // unused
-    ConfigTable *t = (ConfigTable *)table;
-    free_table(t);
+    mapFree((Map *)map);
+    free(map);
 }
 
-/* public functions */
+/* environment variables */
 
-ConfigTable *config_parse(ConfigParser *p, const char *config_file_path) {
-    if(!p) {
+// Expand ${NAME}, ${NAME:-default} and $${ (a literal "${") in a string.
+// returns 'value' if there is nothing to expand, a new string allocated from 'arena',
+// or NULL if a variable isn't set and has no default.
+static char *expand_env(const char *path, char *value, Arena *arena) {
+    if(!strstr(value, "${")) {
+        return value;
+    }
+    size_t capacity = strlen(value) + 1, length = 0;
+    char *out = arenaAlloc(arena, capacity);
+    const char *c = value;
+    while(*c) {
+        const char *insert = c;
+        size_t insert_length = 1;
+        if(c[0] == '$' && c[1] == '$' && c[2] == '{') {
+            insert_length = 2;
+            insert = c + 1;
+            c += 3;
+        } else if(c[0] == '$' && c[1] == '{') {
+            const char *end = strchr(c + 2, '}');
+            if(!end) {
+                file_error(path, "Unterminated '${' in \"%s\".", value);
+                return NULL;
+            }
+            const char *fallback = strstr(c + 2, ":-");
+            if(fallback && fallback > end) {
+                fallback = NULL;
+            }
+            char *name = arenaStrndup(arena, c + 2, (fallback ? fallback : end) - (c + 2));
+            insert = getenv(name);
+            if(insert) {
+                insert_length = strlen(insert);
+            } else if(fallback) {
+                insert = fallback + 2;
+                insert_length = end - insert;
+            } else {
+                file_error(path, "Environment variable '%s' is not set.", name);
+                return NULL;
+            }
+            c = end + 1;
+        } else {
+            c++;
+        }
+        if(length + insert_length + 1 > capacity) {
+            // the old buffer stays in the arena until it is reset.
+            capacity = (length + insert_length + 1) * 2;
+            char *grown = arenaAlloc(arena, capacity);
+            memcpy(grown, out, length);
+            out = grown;
+        }
+        memcpy(out + length, insert, insert_length);
+        length += insert_length;
+    }
+    out[length] = '\0';
+    return out;
+}
+
+static bool expand_env_in_tables(const char *path, Array *tables, Arena *arena) {
+    for(size_t i = 0; i < tables->used; ++i) {
+        ConfigTable *t = ARRAY_GET_AS(ConfigTable *, tables, i);
+        for(size_t j = 0; j < t->pairs.used; ++j) {
+            Pair *pair = ARRAY_GET_AS(Pair *, &t->pairs, j);
+            if(pair->value.type != LIT_STRING) {
+                continue;
+            }
+            char *expanded = expand_env(path, pair->value.as.string, arena);
+            if(!expanded) {
+                return false;
+            }
+            pair->value.as.string = expanded;
+        }
+    }
+    return true;
+}
+
+/* frozen tables */
+
+// sets errno.
+static bool freeze_table(ConfigTable *t) {
+    if(t->slots || t->pairs.used == 0) {
+        return true;
+    }
+    const char **keys = malloc(t->pairs.used * sizeof(*keys));
+    size_t *key_slots = malloc(t->pairs.used * sizeof(*key_slots));
+    Pair **slots = malloc(t->pairs.used * sizeof(*slots));
+    if(!keys || !key_slots || !slots) {
+        free(keys);
+        free(key_slots);
+        free(slots);
+        errno = ENOMEM;
+        return false;
+    }
+    for(size_t i = 0; i < t->pairs.used; ++i) {
+        keys[i] = ARRAY_GET_AS(Pair *, &t->pairs, i)->key;
+    }
+    // the keys are distinct as the tables of a configuration that
+    // defines a key twice are merged, which replaces duplicate keys.
+    bool ok = phfBuild(&t->phf, keys, t->pairs.used, key_slots);
+    free(keys);
+    if(!ok) {
+        free(key_slots);
+        free(slots);
+        errno = ENOMEM;
+        return false;
+    }
+    // the slot of every key is known from the build, so the keys aren't hashed again.
+    for(size_t i = 0; i < t->pairs.used; ++i) {
+        slots[key_slots[i]] = ARRAY_GET_AS(Pair *, &t->pairs, i);
+    }
+    free(key_slots);
+    t->slots = slots;
+    return true;
+}
+
+/* files */
+
+static inline Array *current_tables(ConfigFile *f) {
+    return f->pending ? f->pending : &f->tables;
+}
+
+static ConfigFile *find_file(ConfigParser *p, dev_t device, ino_t inode) {
+    for(size_t i = 0; i < p->files->used; ++i) {
+        ConfigFile *f = ARRAY_GET_AS(ConfigFile *, p->files, i);
+        if(f->device == device && f->inode == inode) {
+            return f;
+        }
+    }
+    return NULL;
+}
+
+// Get a file from the spare files of the pool, or allocate a new one.
+// sets errno.
+static ConfigFile *new_file(ConfigPool *pool, const char *path) {
+    ConfigFile *f = ARRAY_POP_AS(ConfigFile *, &pool->spare_files);
+    if(!f) {
+        f = calloc(1, sizeof(*f));
+        if(!f) {
+            // errno is set by calloc().
+            return NULL;
+        }
+        arenaInit(&f->arenas[0]);
+        arenaInit(&f->arenas[1]);
+    }
+    if(!copy_string(&f->path, &f->path_capacity, path)) {
+        free_file(f);
+        return NULL;
+    }
+    arrayInitArena(&f->tables, &f->arenas[f->current]);
+    return f;
+}
+
+// Keep the memory of a file that is no longer part of the configuration for a later one.
+static void release_file(ConfigPool *pool, ConfigFile *f) {
+    arenaReset(&f->arenas[0]);
+    arenaReset(&f->arenas[1]);
+    f->pending = NULL;
+    f->committed = false;
+    f->visited = false;
+    f->mtime = (struct timespec){0, 0};
+    f->size = 0;
+    arrayPush(&pool->spare_files, (void *)f);
+}
+
+// Whether a table defines a key twice. The set only grows, so reparsing
+// configurations as large as the previous ones doesn't allocate.
+// The answer is kept in the table (and its snapshot), as the pairs of a table don't change.
+static bool has_duplicate_keys(ConfigPool *pool, ConfigTable *t) {
+    if(t->distinct_keys) {
+        return false;
+    }
+    size_t capacity = 16;
+    while(capacity < t->pairs.used * 2) {
+        capacity *= 2;
+    }
+    if(capacity > pool->key_set_capacity) {
+        uint64_t *set = realloc(pool->key_set, capacity * sizeof(*set));
+        if(!set) {
+            // merging finds the duplicate keys as well.
+            return true;
+        }
+        pool->key_set = set;
+        pool->key_set_capacity = capacity;
+    }
+    uint64_t *set = pool->key_set;
+    memset(set, 0, capacity * sizeof(*set));
+    for(size_t i = 0; i < t->pairs.used; ++i) {
+        const char *key = ARRAY_GET_AS(Pair *, &t->pairs, i)->key;
+        uint64_t hash = hashBytes(key, strlen(key), 0);
+        uint64_t tag = hash & 0xffffffff00000000ull;
+        size_t slot = hash & (capacity - 1);
+        while(set[slot]) {
+            if((set[slot] & 0xffffffff00000000ull) == tag) {
+                Pair *other = ARRAY_GET_AS(Pair *, &t->pairs, (set[slot] & 0xffffffffu) - 1);
+                if(!strcmp(other->key, key)) {
+                    return true;
+                }
+            }
+            slot = (slot + 1) & (capacity - 1);
+        }
+        // a file is at most 4 GiB, so it has less than 2^32 pairs.
+        set[slot] = tag | (i + 1);
+    }
+    t->distinct_keys = true;
+    return false;
+}
+
+// Parse the contents of a file, or load its tables from the snapshot cache.
+// The snapshots hold the tables before environment variables are expanded,
+// as they depend on the environment of the process.
+static bool parse_contents(ConfigPool *pool, const char *path, const struct stat *st, char *contents, Array *tables, Arena *arena) {
+    if(!pool->cache_dir) {
+        return config_parser_parse(contents, tables, arena);
+    }
+    size_t length = strlen(contents);
+    if(snapshotLoad(pool->cache_dir, path, st, contents, length, tables, arena)) {
+        return true;
+    }
+    if(!config_parser_parse(contents, tables, arena)) {
+        return false;
+    }
+    // the snapshot records which tables have distinct keys, so loading it doesn't check them again.
+    for(size_t i = 0; i < tables->used; ++i) {
+        has_duplicate_keys(pool, ARRAY_GET_AS(ConfigTable *, tables, i));
+    }
+    snapshotWrite(pool->cache_dir, path, st, contents, length, tables);
+    return true;
+}
+
+// Return the cached file at 'path', reading and parsing it again only if it changed.
+// sets errno.
+static ConfigFile *load_file(ConfigParser *p, const char *path) {
+    struct stat st;
+    char *contents;
+    ConfigFile *f;
+    if(p->pool->preloaded) {
+        // config_parse_many() already read the file into the pool's buffer.
+        p->pool->preloaded = false;
+        st = p->pool->preloaded_stat;
+        contents = p->pool->buffer;
+        f = find_file(p, st.st_dev, st.st_ino);
+    } else {
+        int fd = open(path, O_RDONLY | O_CLOEXEC);
+        if(fd < 0) {
+            // errno is set by open().
+            file_error(path, "%s.", strerror(errno));
+            return NULL;
+        }
+        if(fstat(fd, &st) < 0 || S_ISDIR(st.st_mode)) {
+            if(S_ISDIR(st.st_mode)) {
+                errno = EISDIR;
+            }
+            file_error(path, "%s.", strerror(errno));
+            close(fd);
+            return NULL;
+        }
+
+        f = find_file(p, st.st_dev, st.st_ino);
+        if(f && f->mtime.tv_sec == st.st_mtim.tv_sec && f->mtime.tv_nsec == st.st_mtim.tv_nsec && f->size == st.st_size) {
+            close(fd);
+            f->visited = true;
+            return f;
+        }
+
+        contents = read_file(p->pool, fd, (size_t)st.st_size);
+        int saved_errno = errno;
+        close(fd);
+        if(!contents) {
+            errno = saved_errno;
+            file_error(path, "%s.", strerror(errno));
+            return NULL;
+        }
+    }
+
+    if(!f) {
+        f = new_file(p->pool, path);
+        if(!f) {
+            file_error(path, "%s.", strerror(errno));
+            return NULL;
+        }
+        f->device = st.st_dev;
+        f->inode = st.st_ino;
+        // the file is uncommitted, so it is released if the build fails.
+        arrayPush(p->files, (void *)f);
+    }
+    Arena *arena = &f->arenas[!f->current];
+    arenaReset(arena);
+    Array *tables = arenaAlloc(arena, sizeof(*tables));
+    arrayInitArena(tables, arena);
+    if(!parse_contents(p->pool, path, &st, contents, tables, arena) ||
+       (p->pool->expand_env && !expand_env_in_tables(path, tables, arena))) {
+        arenaReset(arena);
+        f->pending = NULL;
         errno = EINVAL;
         return NULL;
     }
+    f->pending = tables;
+    f->mtime = st.st_mtim;
+    f->size = st.st_size;
+    f->visited = true;
+    return f;
+}
 
-    p->config_file_path = strdup(config_file_path);
+// Replace the tables of every file that was read again by their new version,
+// and forget the files that are no longer part of the configuration.
+static void commit_files(ConfigParser *p) {
+    size_t kept = 0;
+    for(size_t i = 0; i < p->files->used; ++i) {
+        ConfigFile *f = ARRAY_GET_AS(ConfigFile *, p->files, i);
+        if(!f->visited) {
+            release_file(p->pool, f);
+            continue;
+        }
+        if(f->pending) {
+            f->tables = *f->pending;
+            f->pending = NULL;
+            arenaReset(&f->arenas[f->current]);
+            f->current = !f->current;
+        }
+        f->committed = true;
+        f->visited = false;
+        p->files->data[kept++] = (void *)f;
+    }
+    p->files->used = kept;
+}
 
-    char *file_contents = read_file(config_file_path);
-    if(!file_contents) {
-        // errno is set by read_file().
+// Drop the new versions of the files read by a failed build.
+static void rollback_files(ConfigParser *p) {
+    size_t kept = 0;
+    for(size_t i = 0; i < p->files->used; ++i) {
+        ConfigFile *f = ARRAY_GET_AS(ConfigFile *, p->files, i);
+        if(!f->committed) {
+            release_file(p->pool, f);
+            continue;
+        }
+        if(f->pending) {
+            arenaReset(&f->arenas[!f->current]);
+            f->pending = NULL;
+            // make sure the file is read again by the next reload.
+            f->mtime = (struct timespec){0, 0};
+        }
+        f->visited = false;
+        p->files->data[kept++] = (void *)f;
+    }
+    p->files->used = kept;
+}
+
+/* merging */
+
+typedef struct merge_state {
+    Array *tables; // Array<ConfigTable *>, the merged tables.
+    Arena *arena; // the merged tables are allocated from it.
+    Map *table_indices; // table name -> index in 'tables'.
+    Array *pair_indices; // Array<Map *>, key -> index in the pairs of the table at the same index in 'tables'.
+    Array *stack; // Array<ConfigFile *>, the files being merged, used to detect include cycles.
+    bool includes; // whether top-level 'include' pairs are resolved.
+} MergeState;
+
+// 'expected_pairs' is used to size the key index of a new table.
+static size_t merged_table(MergeState *m, char *name, size_t expected_pairs) {
+    size_t index;
+    if(mapGet(m->table_indices, name, &index)) {
+        return index;
+    }
+    ConfigTable *t = arenaCalloc(m->arena, sizeof(*t));
+    t->name = name;
+    arrayInitArena(&t->pairs, m->arena);
+    index = arrayPush(m->tables, (void *)t);
+    mapSet(m->table_indices, name, index);
+    // the key indices of the previous builds are reused.
+    if(index < m->pair_indices->used) {
+        mapClear(ARRAY_GET_AS(Map *, m->pair_indices, index), expected_pairs);
+    } else {
+        Map *pairs = malloc(sizeof(*pairs));
+        mapInitCapacity(pairs, expected_pairs);
+        arrayPush(m->pair_indices, (void *)pairs);
+    }
+    return index;
+}
+
+// Later definitions of a key replace earlier ones.
+static void merge_pair(MergeState *m, size_t table_index, Pair *pair) {
+    ConfigTable *t = ARRAY_GET_AS(ConfigTable *, m->tables, table_index);
+    Map *pairs = ARRAY_GET_AS(Map *, m->pair_indices, table_index);
+    size_t index;
+    if(mapGet(pairs, pair->key, &index)) {
+        t->pairs.data[index] = (void *)pair;
+    } else {
+        mapSet(pairs, pair->key, arrayPush(&t->pairs, (void *)pair));
+    }
+}
+
+// include paths are relative to the directory of the including file.
+static char *include_path(MergeState *m, const char *including_file, const char *path) {
+    const char *slash = strrchr(including_file, '/');
+    if(path[0] == '/' || !slash) {
+        return arenaStrndup(m->arena, path, strlen(path));
+    }
+    size_t dir_length = slash - including_file + 1;
+    char *result = arenaAlloc(m->arena, dir_length + strlen(path) + 1);
+    memcpy(result, including_file, dir_length);
+    strcpy(result + dir_length, path);
+    return result;
+}
+
+static bool merge_file(ConfigParser *p, MergeState *m, const char *path);
+
+static bool merge_tables(ConfigParser *p, MergeState *m, ConfigFile *f) {
+    for(size_t i = 0; i < m->stack->used; ++i) {
+        if(ARRAY_GET_AS(ConfigFile *, m->stack, i) == f) {
+            file_error(f->path, "Include cycle detected.");
+            errno = ELOOP;
+            return false;
+        }
+    }
+    arrayPush(m->stack, (void *)f);
+
+    Array *tables = current_tables(f);
+    for(size_t i = 0; i < tables->used; ++i) {
+        ConfigTable *t = ARRAY_GET_AS(ConfigTable *, tables, i);
+        size_t table_index = merged_table(m, t->name, t->pairs.used);
+        for(size_t j = 0; j < t->pairs.used; ++j) {
+            Pair *pair = ARRAY_GET_AS(Pair *, &t->pairs, j);
+            // the first table is always the top-level.
+            if(i == 0 && m->includes && !strcmp(pair->key, INCLUDE_KEY)) {
+                if(pair->value.type != LIT_STRING) {
+                    file_error(f->path, "The value of '" INCLUDE_KEY "' has to be a string.");
+                    errno = EINVAL;
+                    return false;
+                }
+                if(!merge_file(p, m, include_path(m, f->path, pair->value.as.string))) {
+                    return false;
+                }
+                continue;
+            }
+            merge_pair(m, table_index, pair);
+        }
+    }
+
+    arrayPop(m->stack);
+    return true;
+}
+
+static bool merge_file(ConfigParser *p, MergeState *m, const char *path) {
+    ConfigFile *f = load_file(p, path);
+    if(!f) {
+        return false;
+    }
+    return merge_tables(p, m, f);
+}
+
+// Whether the tables of the configuration file have to be merged: if one of its top-level
+// 'include' pairs has to be resolved, or if it defines a table or a key twice.
+static bool needs_merging(ConfigPool *pool, MergeState *m, Array *tables) {
+    mapClear(m->table_indices, tables->used);
+    for(size_t i = 0; i < tables->used; ++i) {
+        ConfigTable *t = ARRAY_GET_AS(ConfigTable *, tables, i);
+        size_t index;
+        if(mapGet(m->table_indices, t->name, &index) || has_duplicate_keys(pool, t)) {
+            return true;
+        }
+        mapSet(m->table_indices, t->name, i);
+        // the first table is always the top-level.
+        for(size_t j = 0; i == 0 && m->includes && j < t->pairs.used; ++j) {
+            if(!strcmp(ARRAY_GET_AS(Pair *, &t->pairs, j)->key, INCLUDE_KEY)) {
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+// The tables of a configuration file that doesn't need merging are used as they are:
+// the merged tables share their pairs, which aren't modified once they are parsed.
+static void share_tables(MergeState *m, Array *tables) {
+    for(size_t i = 0; i < tables->used; ++i) {
+        ConfigTable *source = ARRAY_GET_AS(ConfigTable *, tables, i);
+        ConfigTable *t = arenaCalloc(m->arena, sizeof(*t));
+        t->name = source->name;
+        t->pairs = source->pairs;
+        arrayPush(m->tables, (void *)t);
+    }
+}
+
+// sets errno.
+static bool freeze_tables(Array *tables) {
+    for(size_t i = 0; i < tables->used; ++i) {
+        if(!freeze_table(ARRAY_GET_AS(ConfigTable *, tables, i))) {
+            // errno is set by freeze_table().
+            return false;
+        }
+    }
+    return true;
+}
+
+// Build the merged tables of the configuration file and the files it includes.
+// A configuration file that doesn't need merging (see needs_merging()) is used as it is.
+// The tables are allocated from the arena that isn't used by the current tables.
+// They are frozen before the new versions of the files replace the previous ones,
+// so the current tables are still valid if freezing them fails.
+// sets errno.
+static Array *build(ConfigParser *p, bool freeze) {
+    ConfigPool *pool = p->pool;
+    Arena *arena = &pool->table_arenas[!pool->current_tables];
+    arenaReset(arena);
+    MergeState m = {
+        .tables = arenaAlloc(arena, sizeof(Array)),
+        .arena = arena,
+        .table_indices = &pool->table_indices,
+        .pair_indices = &pool->pair_indices,
+        .stack = &pool->stack,
+        .includes = pool->includes
+    };
+    arrayInitArena(m.tables, arena);
+    arrayClear(m.stack);
+
+    ConfigFile *f = load_file(p, p->config_file_path);
+    bool ok = f != NULL;
+    if(ok && !needs_merging(pool, &m, current_tables(f))) {
+        share_tables(&m, current_tables(f));
+    } else if(ok) {
+        mapClear(m.table_indices, 0);
+        // the top-level table is always the first one, even if the file is empty.
+        merged_table(&m, TOPLEVEL_TABLE_NAME, 0);
+        ok = merge_tables(p, &m, f);
+    }
+    if(!ok || (freeze && !freeze_tables(m.tables))) {
+        int saved_errno = errno;
+        unfreeze_tables(m.tables);
+        arenaReset(arena);
+        rollback_files(p);
+        errno = saved_errno;
+        return NULL;
+    }
+    commit_files(p);
+    return m.tables;
+}
+
+// The chains are allocated from the arena of the current tables, so they are dropped with them.
+static void drop_chains(ConfigPool *pool) {
+    unfreeze_tables(&pool->chains);
+    arrayClear(&pool->chains);
+}
+
+// Replace the current tables by tables returned by build().
+static void install_tables(ConfigParser *p, Array *tables) {
+    ConfigPool *pool = p->pool;
+    if(p->tables) {
+        unfreeze_tables(p->tables);
+    }
+    drop_chains(pool);
+    arenaReset(&pool->table_arenas[pool->current_tables]);
+    pool->current_tables = !pool->current_tables;
+    p->tables = tables;
+}
+
+// sets errno.
+static ConfigPool *new_pool(void) {
+    ConfigPool *pool = calloc(1, sizeof(*pool));
+    if(!pool) {
+        // errno is set by calloc().
         return NULL;
     }
+    arrayInit(&pool->files);
+    arrayInit(&pool->spare_files);
+    arenaInit(&pool->table_arenas[0]);
+    arenaInit(&pool->table_arenas[1]);
+    mapInit(&pool->table_indices);
+    arrayInit(&pool->pair_indices);
+    arrayInit(&pool->stack);
+    arrayInit(&pool->chains);
+    return pool;
+}
+
+static void free_pool(ConfigPool *pool) {
+    // the chains are allocated from the table arenas.
+    drop_chains(pool);
+    arrayMap(&pool->files, free_file_callback, NULL);
+    arrayFree(&pool->files);
+    arrayMap(&pool->spare_files, free_file_callback, NULL);
+    arrayFree(&pool->spare_files);
+    arenaFree(&pool->table_arenas[0]);
+    arenaFree(&pool->table_arenas[1]);
+    free(pool->path);
+    free(pool->buffer);
+    free(pool->cache_dir);
+    mapFree(&pool->table_indices);
+    arrayMap(&pool->pair_indices, free_map_callback, NULL);
+    arrayFree(&pool->pair_indices);
+    arrayFree(&pool->stack);
+    arrayFree(&pool->chains);
+    free(pool->key_set);
+    free(pool);
+}
 
-    // The tables array has to be stored on the heap because as the public header
+// sets errno.
+bool config_init_parser(ConfigParser *p) {
+    p->tables = NULL;
+    p->config_file_path = NULL;
+    p->pool = new_pool();
+    if(!p->pool) {
+        p->files = NULL;
+        // errno is set by new_pool().
+        return false;
+    }
+    // The arrays are stored in the pool because as the public header
     // doesn't include array.h but needs ConfigParser to be a complete type, Array is
     // declared as an incomplete type and so can only be used as a pointer type.
-    p->tables = calloc(1, sizeof *p->tables);
-    arrayInit(p->tables);
-    if(!config_parser_parse(file_contents, p->tables)) {
-        free(file_contents);
-        arrayMap(p->tables, free_table_callback, NULL);
+    p->files = &p->pool->files;
+    return true;
+}
+
+// sets errno.
+bool config_set_options(ConfigParser *p, const ConfigParseOptions *opts) {
+    p->pool->includes = opts->includes;
+    p->pool->expand_env = opts->expand_env;
+    if(!opts->cache_dir) {
+        return true;
+    }
+    int fd = snapshotOpenDir(opts->cache_dir);
+    if(fd < 0) {
+        // errno is set by snapshotOpenDir().
+        return false;
+    }
+    close(fd);
+    if(!copy_string(&p->pool->cache_dir, &p->pool->cache_dir_capacity, opts->cache_dir)) {
+        // errno is set by copy_string().
+        return false;
+    }
+    return true;
+}
+
+// sets errno.
+ConfigTable *config_load(ConfigParser *p, const char *config_file_path) {
+    p->config_file_path = copy_string(&p->pool->path, &p->pool->path_capacity, config_file_path);
+    if(!p->config_file_path) {
+        // errno is set by copy_string().
         return NULL;
     }
-    free(file_contents);
+    Array *tables = build(p, false);
+    if(!tables) {
+        // errno is set by build().
+        return NULL;
+    }
+    install_tables(p, tables);
     // the first table is aways present and is the top-level.
     return ARRAY_GET_AS(ConfigTable *, p->tables, 0);
 }
 
+/* public functions */
+
 void config_end(ConfigParser *p) {
-    arrayMap(p->tables, free_table_callback, NULL);
-    arrayFree(p->tables);
-    free(p->tables);
-    free(p->config_file_path);
+    if(p->pool) {
+        if(p->tables) {
+            unfreeze_tables(p->tables);
+        }
+        free_pool(p->pool);
+    }
+    p->pool = NULL;
+    p->tables = NULL;
+    p->files = NULL;
+    p->config_file_path = NULL;
 }
 
+ConfigTable *config_parse(ConfigParser *p, const char *config_file_path) {
+    return config_parse_with_options(p, config_file_path, NULL);
+}
 
+ConfigTable *config_parse_with_options(ConfigParser *p, const char *config_file_path, const ConfigParseOptions *opts) {
+    if(!p) {
+        errno = EINVAL;
+        return NULL;
+    }
+    ConfigParseOptions defaults = {0};
+    if(!opts) {
+        opts = &defaults;
+    }
+
+    if(!config_init_parser(p)) {
+        return NULL;
+    }
+    ConfigTable *top_level = config_set_options(p, opts) ? config_load(p, config_file_path) : NULL;
+    if(!top_level) {
+        int saved_errno = errno;
+        config_end(p);
+        errno = saved_errno;
+        return NULL;
+    }
+    return top_level;
+}
+
+ConfigTable *config_parse_cached(ConfigParser *p, const char *config_file_path, const char *cache_dir) {
+    ConfigParseOptions opts = {.cache_dir = cache_dir};
+    return config_parse_with_options(p, config_file_path, &opts);
+}
+
+bool config_cache_prune(const char *cache_dir) {
+    if(!cache_dir) {
+        errno = EINVAL;
+        return false;
+    }
+    // errno is set by snapshotPrune().
+    return snapshotPrune(cache_dir);
+}
+
+void config_reset(ConfigParser *p) {
+    if(!p->pool) {
+        return;
+    }
+    drop_chains(p->pool);
+    if(p->tables) {
+        unfreeze_tables(p->tables);
+        arenaReset(&p->pool->table_arenas[p->pool->current_tables]);
+        p->tables = NULL;
+    }
+    for(size_t i = 0; i < p->files->used; ++i) {
+        release_file(p->pool, ARRAY_GET_AS(ConfigFile *, p->files, i));
+    }
+    arrayClear(p->files);
+}
+
+ConfigTable *config_reparse(ConfigParser *p, const char *config_file_path) {
+    if(!p) {
+        errno = EINVAL;
+        return NULL;
+    }
+    if(p->pool) {
+        config_reset(p);
+    } else if(!config_init_parser(p)) {
+        return NULL;
+    }
+    // on failure the parser keeps its memory for the next configuration.
+    return config_load(p, config_file_path);
+}
+
+bool config_freeze(ConfigParser *p) {
+    if(!p->tables) {
+        errno = EINVAL;
+        return false;
+    }
+    // errno is set by freeze_tables().
+    return freeze_tables(p->tables);
+}
+
+ConfigTable *config_reload(ConfigParser *p) {
+    if(!p->pool || !p->config_file_path) {
+        errno = EINVAL;
+        return NULL;
+    }
+    // empty tables are never frozen, so look for any frozen table.
+    bool frozen = false;
+    for(size_t i = 0; p->tables && i < p->tables->used && !frozen; ++i) {
+        frozen = ARRAY_GET_AS(ConfigTable *, p->tables, i)->slots != NULL;
+    }
+    // on failure, including a failure to freeze the new tables, the previous configuration is kept.
+    Array *tables = build(p, frozen);
+    if(!tables) {
+        // errno is set by build().
+        return NULL;
+    }
+    install_tables(p, tables);
+    return ARRAY_GET_AS(ConfigTable *, p->tables, 0);
+}
+
+// p->tables is NULL after config_reset() or a failed config_reparse().
 int config_table_count(ConfigParser *p) {
-    return p->tables->used;
+    return p->tables ? p->tables->used : 0;
 }
 
 ConfigTable *config_get_table(ConfigParser *p, const char *name) {
-    for(size_t i = 0; i < p->tables->used; ++i) {
+    for(size_t i = 0; p->tables && i < p->tables->used; ++i) {
         ConfigTable *table = ARRAY_GET_AS(ConfigTable *, p->tables, i);
         if(!strcmp(table->name, name)) {
             return table;
@@ -110,49 +896,157 @@ ConfigTable *config_get_table(ConfigParser *p, const char *name) {
     return NULL;
 }
 
-#define MAKE_VALUE(ok_, type, val) ((ConfigValue){.ok = (ok_), .as = {.type = (val)}})
-ConfigValue config_get_string(ConfigTable *t, const char *key) {
-    for(size_t i = 0; i < t->pairs.used; ++i) {
-        Pair *pair = ARRAY_GET_AS(Pair *, &t->pairs, i);
-        if(!strcmp(pair->key, key)) {
-            if(pair->value.type != LIT_STRING) {
-                return MAKE_VALUE(false, number, 0);
-            } else {
-                return MAKE_VALUE(true, string, pair->value.as.string);
+_Static_assert((int)CONFIG_TYPE_NONE == (int)LIT_NONE &&
+               (int)CONFIG_TYPE_NUMBER == (int)LIT_NUMBER &&
+               (int)CONFIG_TYPE_BOOLEAN == (int)LIT_BOOLEAN &&
+               (int)CONFIG_TYPE_STRING == (int)LIT_STRING &&
+               (int)CONFIG_TYPE_DATETIME == (int)LIT_DATETIME &&
+               (int)CONFIG_TYPE_DURATION == (int)LIT_DURATION &&
+               (int)CONFIG_TYPE_SIZE == (int)LIT_SIZE, "ConfigType has to match LiteralType");
+_Static_assert(sizeof(((ConfigValue *)0)->as) == sizeof(((Literal *)0)->as), "ConfigValue and Literal have to have the same union");
+
+ConfigTable *config_chain(ConfigParser *p, ConfigTable **tables, size_t n) {
+    if(!p->pool || !p->tables || n == 0) {
+        errno = EINVAL;
+        return NULL;
+    }
+    ConfigPool *pool = p->pool;
+    Arena *arena = &pool->table_arenas[pool->current_tables];
+    size_t total = 0;
+    for(size_t i = 0; i < n; ++i) {
+        total += tables[i]->pairs.used;
+    }
+    ConfigTable *chain = arenaCalloc(arena, sizeof(*chain));
+    if(!chain) {
+        errno = ENOMEM;
+        return NULL;
+    }
+    chain->name = tables[0]->name;
+    arrayInitArena(&chain->pairs, arena);
+    // the keys are distinct in every table, so a key only has to be
+    // skipped if one of the previous tables of the chain has it.
+    Map seen;
+    mapInitCapacity(&seen, total);
+    for(size_t i = 0; i < n; ++i) {
+        for(size_t j = 0; j < tables[i]->pairs.used; ++j) {
+            Pair *pair = ARRAY_GET_AS(Pair *, &tables[i]->pairs, j);
+            size_t index;
+            if(!mapGet(&seen, pair->key, &index)) {
+                mapSet(&seen, pair->key, arrayPush(&chain->pairs, (void *)pair));
             }
         }
     }
-    errno = EINVAL;
-    return MAKE_VALUE(false, number, 0);
+    mapFree(&seen);
+    if(!freeze_table(chain)) {
+        // errno is set by freeze_table().
+        return NULL;
+    }
+    arrayPush(&pool->chains, (void *)chain);
+    return chain;
 }
 
-ConfigValue config_get_number(ConfigTable *t, const char *key) {
-    for(size_t i = 0; i < t->pairs.used; ++i) {
-        Pair *pair = ARRAY_GET_AS(Pair *, &t->pairs, i);
-        if(!strcmp(pair->key, key)) {
-            if(pair->value.type != LIT_NUMBER) {
-                return MAKE_VALUE(false, number, 0);
-            } else {
-                return MAKE_VALUE(true, number, pair->value.as.number);
-            }
-        }
+const char *config_table_name(ConfigTable *t) {
+    return t->name;
+}
+
+ConfigIter config_table_iter(ConfigTable *t) {
+    return (ConfigIter){
+        .current = t->pairs.data,
+        .end = t->pairs.data + t->pairs.used
+    };
+}
+
+bool config_iter_next(ConfigIter *it, const char **key, ConfigType *type, ConfigValue *value) {
+    if(it->current == it->end) {
+        return false;
     }
-    errno = EINVAL;
-    return MAKE_VALUE(false, number, 0);
+    Pair *pair = (Pair *)*it->current++;
+    if(key) {
+        *key = pair->key;
+    }
+    if(type) {
+        *type = (ConfigType)pair->value.type;
+    }
+    if(value) {
+        // Literal and ConfigValue have the same union.
+        value->ok = true;
+        memcpy(&value->as, &pair->value.as, sizeof(value->as));
+    }
+    return true;
 }
 
-ConfigValue config_get_boolean(ConfigTable *t, const char *key) {
-    for(size_t i = 0; i < t->pairs.used; ++i) {
-        Pair *pair = ARRAY_GET_AS(Pair *, &t->pairs, i);
-        if(!strcmp(pair->key, key)) {
-            if(pair->value.type != LIT_BOOLEAN) {
-                return MAKE_VALUE(false, number, 0);
-            } else {
-                return MAKE_VALUE(true, boolean, pair->value.as.boolean);
-            }
-        }
+ConfigIter config_tables_iter(ConfigParser *p) {
+    if(!p->tables) {
+        return (ConfigIter){NULL, NULL};
     }
-    errno = EINVAL;
-    return MAKE_VALUE(false, number, 0);
+    return (ConfigIter){
+        .current = p->tables->data,
+        .end = p->tables->data + p->tables->used
+    };
+}
+
+bool config_tables_next(ConfigIter *it, ConfigTable **table, const char **name) {
+    if(it->current == it->end) {
+        return false;
+    }
+    ConfigTable *t = (ConfigTable *)*it->current++;
+    if(table) {
+        *table = t;
+    }
+    if(name) {
+        *name = t->name;
+    }
+    return true;
+}
+
+ConfigValue config_get_string(ConfigTable *t, const char *key) {
+    return config_get_string_inline(t, key);
+}
+
+ConfigValue config_get_number(ConfigTable *t, const char *key) {
+    return config_get_number_inline(t, key);
+}
+
+ConfigValue config_get_boolean(ConfigTable *t, const char *key) {
+    return config_get_boolean_inline(t, key);
+}
+
+ConfigValue config_get_datetime(ConfigTable *t, const char *key) {
+    return config_get_datetime_inline(t, key);
+}
+
+ConfigValue config_get_duration(ConfigTable *t, const char *key) {
+    return config_get_duration_inline(t, key);
+}
+
+ConfigValue config_get_size(ConfigTable *t, const char *key) {
+    return config_get_size_inline(t, key);
+}
+
+ConfigType config_get_type(ConfigTable *t, const char *key) {
+    return config_get_type_inline(t, key);
+}
+
+const char *config_get_string_or(ConfigTable *t, const char *key, const char *def) {
+    return config_get_string_or_inline(t, key, def);
+}
+
+int64_t config_get_number_or(ConfigTable *t, const char *key, int64_t def) {
+    return config_get_number_or_inline(t, key, def);
+}
+
+bool config_get_boolean_or(ConfigTable *t, const char *key, bool def) {
+    return config_get_boolean_or_inline(t, key, def);
+}
+
+int64_t config_get_datetime_or(ConfigTable *t, const char *key, int64_t def) {
+    return config_get_datetime_or_inline(t, key, def);
+}
+
+int64_t config_get_duration_or(ConfigTable *t, const char *key, int64_t def) {
+    return config_get_duration_or_inline(t, key, def);
+}
+
+int64_t config_get_size_or(ConfigTable *t, const char *key, int64_t def) {
+    return config_get_size_or_inline(t, key, def);
 }
-#undef MAKE_VALUE
@@ -0,0 +1,69 @@
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h> // memcpy
+#include "hash.h"
+
+#define P0 0xa0761d6478bd642full
+#define P1 0xe7037ed1a0b428dbull
+#define P2 0x8ebc6af09c88c6e3ull
+#define P3 0x589965cc75374cc3ull
+
+static inline uint64_t mum(uint64_t a, uint64_t b) {
+    HashUint128 r = (HashUint128)a * b;
+    return (uint64_t)r ^ (uint64_t)(r >> 64);
+}
+
+static inline uint64_t read64(const uint8_t *p) {
+    uint64_t v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+static inline uint64_t read32(const uint8_t *p) {
+    uint32_t v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+// reads 1 to 3 bytes.
+static inline uint64_t read_small(const uint8_t *p, size_t length) {
+    return ((uint64_t)p[0] << 16) | ((uint64_t)p[length >> 1] << 8) | p[length - 1];
+}
+
+uint64_t hashBytes(const void *data, size_t length, uint64_t seed) {
+    const uint8_t *p = (const uint8_t *)data;
+    uint64_t a, b;
+    seed ^= P0;
+    if(length <= 16) {
+        if(length >= 4) {
+            a = (read32(p) << 32) | read32(p + ((length >> 3) << 2));
+            b = (read32(p + length - 4) << 32) | read32(p + length - 4 - ((length >> 3) << 2));
+        } else if(length > 0) {
+            a = read_small(p, length);
+            b = 0;
+        } else {
+            a = b = 0;
+        }
+    } else {
+        size_t i = length;
+        if(i > 48) {
+            uint64_t see1 = seed, see2 = seed;
+            do {
+                seed = mum(read64(p) ^ P1, read64(p + 8) ^ seed);
+                see1 = mum(read64(p + 16) ^ P2, read64(p + 24) ^ see1);
+                see2 = mum(read64(p + 32) ^ P3, read64(p + 40) ^ see2);
+                p += 48;
+                i -= 48;
+            } while(i > 48);
+            seed ^= see1 ^ see2;
+        }
+        while(i > 16) {
+            seed = mum(read64(p) ^ P1, read64(p + 8) ^ seed);
+            p += 16;
+            i -= 16;
+        }
+        a = read64(p + i - 16);
+        b = read64(p + i - 8);
+    }
+    return mum(P1 ^ length, mum(a ^ P1, b ^ seed));
+}
@@ -0,0 +1,105 @@
+#include <stdlib.h>
+#include <string.h> // strcmp, memset
+#include <stdint.h>
+#include <stdbool.h>
+#include "map.h"
+
+// FNV-1a
+static uint64_t hash_string(const char *key) {
+    uint64_t hash = 14695981039346656037u;
+    for(const unsigned char *c = (const unsigned char *)key; *c; ++c) {
+        hash ^= *c;
+        hash *= 1099511628211u;
+    }
+    return hash;
+}
+
+// the capacity is always a power of 2.
+static MapEntry *find_entry(MapEntry *entries, size_t capacity, const char *key, uint64_t hash) {
+    size_t i = hash & (capacity - 1);
+    for(;;) {
+        MapEntry *entry = &entries[i];
+        if(!entry->key || (entry->hash == hash && !strcmp(entry->key, key))) {
+            return entry;
+        }
+        i = (i + 1) & (capacity - 1);
+    }
+}
+
+static void grow(Map *m) {
+    size_t capacity = m->capacity * 2;
+    MapEntry *entries = calloc(capacity, sizeof(*entries));
+    for(size_t i = 0; i < m->capacity; ++i) {
+        MapEntry *entry = &m->entries[i];
+        if(entry->key) {
+            *find_entry(entries, capacity, entry->key, entry->hash) = *entry;
+        }
+    }
+    free(m->entries);
+    m->entries = entries;
+    m->capacity = capacity;
+}
+
+void mapInit(Map *m) {
+    mapInitCapacity(m, 0);
+}
+
+// 'expected' is the number of keys the map is expected to hold.
+void mapInitCapacity(Map *m, size_t expected) {
+    m->used = 0;
+    m->capacity = MAP_INITIAL_CAPACITY;
+    while(m->capacity < expected * 2) {
+        m->capacity *= 2;
+    }
+    m->entries = calloc(m->capacity, sizeof(*m->entries));
+}
+
+void mapFree(Map *m) {
+    free(m->entries);
+    m->entries = NULL;
+    m->used = m->capacity = 0;
+}
+
+// Remove every key but keep the memory, growing it to hold 'expected' keys if needed.
+// Clearing touches the whole capacity, so a map that is much larger than both its last
+// contents and 'expected' (e.g. after a large configuration) is shrunk instead.
+void mapClear(Map *m, size_t expected) {
+    size_t keys = expected > m->used ? expected : m->used;
+    size_t needed = MAP_INITIAL_CAPACITY;
+    while(needed < keys * 2) {
+        needed *= 2;
+    }
+    if(m->capacity < expected * 2 || m->capacity > needed * MAP_SHRINK_FACTOR) {
+        mapFree(m);
+        mapInitCapacity(m, keys);
+        return;
+    }
+    if(m->used > 0) {
+        memset(m->entries, 0, m->capacity * sizeof(*m->entries));
+    }
+    m->used = 0;
+}
+
+bool mapGet(Map *m, const char *key, size_t *value) {
+    MapEntry *entry = find_entry(m->entries, m->capacity, key, hash_string(key));
+    if(!entry->key) {
+        return false;
+    }
+    *value = entry->value;
+    return true;
+}
+
+void mapSet(Map *m, const char *key, size_t value) {
+    // keep the load factor under 0.5.
+    if((m->used + 1) * 2 > m->capacity) {
+        grow(m);
+    }
+    uint64_t hash = hash_string(key);
+    MapEntry *entry = find_entry(m->entries, m->capacity, key, hash);
+    if(!entry->key) {
+        m->used++;
+    }
+    entry->key = key;
+    entry->hash = hash;
+    entry->value = value;
+}
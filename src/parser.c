@@ -1,5 +1,5 @@
 #include <stdlib.h>
-#include <string.h> // strdup
+#include <string.h> // strlen
 #include <stdarg.h>
 #include <stdbool.h>
 #include <string.h>
@@ -7,55 +7,58 @@
 #include "config_internal.h"
 #include "token.h"
 #include "array.h"
+#include "arena.h"
+#include "unescape.h"
+#include "utf8.h"
 #include "parser.h"
 
-void free_literal(Literal l) {
-    if(l.type == LIT_STRING) {
-        free(l.as.string);
-    }
-}
+/* parser */
 
-void free_pair(Pair *p) {
-    free(p->key);
-    free_literal(p->value);
-    free(p);
-}
+// The parser reads the tokens in batches. The first slot of the buffer keeps
+// the last token of the previous batch so that previous() stays valid.
+#ifndef TOKEN_BATCH_SIZE
+#define TOKEN_BATCH_SIZE 64
+#endif
 
-/* parser */
 typedef struct parser {
     Scanner *scanner;
-    Token previous_token, current_token;
+    Arena *arena; // everything the parser produces is allocated from it.
+    Token *current, *end; // the current token and the end of the batch in 'tokens'.
+    Token tokens[TOKEN_BATCH_SIZE];
+    ConfigTable *top_level; // the state of the parser outside of tables.
     bool had_error;
 } Parser;
 
-static inline bool is_eof(Parser *p) {
-    return p->current_token.type == TK_EOF;
+static void refill(Parser *p) {
+    p->tokens[0] = p->end[-1];
+    // error tokens aren't stored in the batch, the scanner already reported them.
+    size_t count = scannerScan(p->scanner, p->tokens + 1, TOKEN_BATCH_SIZE - 1);
+    p->current = p->tokens + 1;
+    p->end = p->current + count;
 }
 
-static Token advance(Parser *p) {
-    // skip error tokens as the scanner already reported them,
-    // but set had_error to true.
-    Token tk;
-    while((tk = scannerNextToken(p->scanner)).type == TK_ERROR) {
-        p->had_error = true;
+static inline void advance_token(Parser *p) {
+    if(++p->current == p->end) {
+        refill(p);
     }
-    p->previous_token = p->current_token;
-    p->current_token = tk;
-    return tk;
 }
 
-static inline Token peek(Parser *p) {
-    return p->current_token;
+static inline TokenType peek_type(Parser *p) {
+    return (TokenType)p->current->type;
 }
 
-static inline Token previous(Parser *p) {
-    return p->previous_token;
+static inline const Token *previous(Parser *p) {
+    return p->current - 1;
 }
 
-static void error(Parser *p, const char *format, ...) {
+static inline bool is_eof(Parser *p) {
+    return peek_type(p) == TK_EOF;
+}
+
+static void parser_error(Parser *p, const char *format, ...) {
     p->had_error = true;
     va_list ap;
-    fprintf(stderr, "[line %d at %d] Error: ", previous(p).line, previous(p).at);
+    fprintf(stderr, "[line %d at %u] Error: ", scannerLine(p->scanner, previous(p)->at), (unsigned)previous(p)->at);
     va_start(ap, format);
     vfprintf(stderr, format, ap);
     va_end(ap);
@@ -63,169 +66,253 @@ static void error(Parser *p, const char *format, ...) {
 }
 
 static bool consume(Parser *p, TokenType expected) {
-    if(peek(p).type != expected) {
-        error(p, "Expected '%s' but got '%s'.", tokenTypeString(expected), tokenTypeString(peek(p).type));
+    if(peek_type(p) != expected) {
+        parser_error(p, "Expected '%s' but got '%s'.", tokenTypeString(expected), tokenTypeString(peek_type(p)));
         return false;
     }
-    advance(p);
+    advance_token(p);
     return true;
 }
 
 static bool match(Parser *p, TokenType expected) {
-    if(peek(p).type != expected) {
+    if(peek_type(p) != expected) {
         return false;
     }
-    advance(p);
+    advance_token(p);
     return true;
 }
 
-#define TRY_CONSUME(parser, expected, on_fail) ({ \
+// Nothing has to be freed on failure as everything is allocated from the parser's arena.
+#define TRY_CONSUME(parser, expected) do { \
                     if(!consume((parser), (expected))) { \
-                        void *_tmp = (on_fail); \
-                        if(_tmp) { free(_tmp); } \
                         return NULL; \
                     } \
-                    true; \
-                    })
+                    } while(0)
+// The last line of the source doesn't have to end with a newline.
+static inline bool consume_line_end(Parser *p) {
+    return is_eof(p) || consume(p, TK_NEWLINE);
+}
+
+// Skip the rest of a line after an error so parsing can continue from the next one.
+static void synchronize(Parser *p) {
+    while(!is_eof(p) && peek_type(p) != TK_NEWLINE) {
+        advance_token(p);
+    }
+    match(p, TK_NEWLINE);
+}
+
 static inline void skip_newlines(Parser *p) {
     while(!is_eof(p) && match(p, TK_NEWLINE)) /* nothing */ ;
 }
 
-static inline Pair *make_pair(char *key, Literal value) {
-    Pair *p = calloc(1, sizeof *p);
-    p->key = key;
-    p->value = value;
-    return p;
+static inline Pair *make_pair(Parser *p, char *key, Literal value) {
+    Pair *pair = arenaAlloc(p->arena, sizeof(*pair));
+    pair->key = key;
+    pair->value = value;
+    return pair;
 }
 
-static inline ConfigTable *make_table(char *name, Array pairs) {
-    ConfigTable *t = calloc(1, sizeof *t);
+static inline ConfigTable *make_table(Parser *p, char *name) {
+    ConfigTable *t = arenaCalloc(p->arena, sizeof(*t));
     t->name = name;
-    t->pairs = pairs;
+    arrayInitArena(&t->pairs, p->arena);
     return t;
 }
 
-static char *parse_identifier(Parser *p) {
+// Copy the contents of the previous (string) token, decoding any escape sequences.
+static char *parse_string(Parser *p) {
+    const Token *tk = previous(p);
+    const char *txt = p->scanner->source + tk->as.slice.start;
+    if(!(tk->flags & TOKEN_HAS_ESCAPES)) {
+        return arenaStrndup(p->arena, txt, tk->as.slice.length);
+    }
+    char *string = arenaAlloc(p->arena, tk->as.slice.length + 1);
+    unescapeString(txt, tk->as.slice.length, string);
+    return string;
+}
+
+// key -> IDENTIFIER | STRING
+static char *parse_key(Parser *p) {
+    if(match(p, TK_STRING)) {
+        return parse_string(p);
+    }
     if(!consume(p, TK_IDENTIFIER)) {
         return NULL;
     }
-    return strndup(previous(p).as.string_or_id.txt, previous(p).as.string_or_id.length);
+    return arenaStrndup(p->arena, p->scanner->source + previous(p)->as.slice.start, previous(p)->as.slice.length);
 }
 
+// The type of the literal of every token type, LIT_NONE for the tokens that aren't literals.
+static const uint8_t literal_types[TK_EOF + 1] = {
+    [TK_NUMBER] = LIT_NUMBER,
+    [TK_DATETIME] = LIT_DATETIME,
+    [TK_DURATION] = LIT_DURATION,
+    [TK_SIZE] = LIT_SIZE,
+    [TK_TRUE] = LIT_BOOLEAN,
+    [TK_FALSE] = LIT_BOOLEAN,
+    [TK_STRING] = LIT_STRING
+};
+
 static Literal parse_literal(Parser *p) {
-    if(match(p, TK_NUMBER)) {
-        return (Literal){
-            .type = LIT_NUMBER,
-            .as.number = previous(p).as.number
-        };
-    } else if(match(p, TK_TRUE)) {
-        return (Literal){
-            .type = LIT_BOOLEAN,
-            .as.boolean = true
-        };
-    } else if(match(p, TK_FALSE)) {
-        return (Literal){
-            .type = LIT_BOOLEAN,
-            .as.boolean = false
-        };
-    } else if(match(p, TK_STRING)) {
-        return (Literal){
-            .type = LIT_STRING,
-            .as.string = strndup(previous(p).as.string_or_id.txt, previous(p).as.string_or_id.length)
-        };
-    } else {
-        error(p, "Expected one of [<number>, true, false, <string>] but got '%s'.", tokenTypeString(peek(p).type));
+    Literal literal = {.type = (LiteralType)literal_types[peek_type(p)]};
+    switch(literal.type) {
+        case LIT_NONE:
+            parser_error(p, "Expected one of [<number>, <datetime>, <duration>, <size>, true, false, <string>] but got '%s'.", tokenTypeString(peek_type(p)));
+            return literal;
+        case LIT_STRING:
+            advance_token(p);
+            literal.as.string = parse_string(p);
+            return literal;
+        case LIT_BOOLEAN:
+            advance_token(p);
+            literal.as.boolean = previous(p)->type == TK_TRUE;
+            return literal;
+        default:
+            // numbers, datetimes, durations and sizes are all stored as an int64_t.
+            advance_token(p);
+            literal.as.number = previous(p)->as.number;
+            return literal;
     }
-    return (Literal){
-        .type = LIT_NONE
-    };
 }
 
 static Pair *parse_pair(Parser *p) {
-    char *key = parse_identifier(p);
+    char *key = parse_key(p);
     if(!key) {
         return NULL;
     }
-    TRY_CONSUME(p, TK_EQUAL, key);
+    TRY_CONSUME(p, TK_EQUAL);
     Literal value = parse_literal(p);
-    if(!consume(p, TK_NEWLINE)) {
-        free(key);
-        free_literal(value);
+    if(!consume_line_end(p)) {
         return NULL;
     }
-    return make_pair(key, value);
+    return make_pair(p, key, value);
 }
 
-static ConfigTable *parse_table(Parser *p) {
-   TRY_CONSUME(p, TK_LBRACKET, 0);
-    char *name = parse_identifier(p);
+// '[' key ']' NEWLINE
+static ConfigTable *parse_table_header(Parser *p) {
+    TRY_CONSUME(p, TK_LBRACKET);
+    char *name = parse_key(p);
     if(!name) {
         return NULL;
     }
-    TRY_CONSUME(p, TK_RBRACKET, name);
-    TRY_CONSUME(p, TK_NEWLINE, name);
-
-    Array pairs;
-    arrayInit(&pairs);
-    while(!is_eof(p) && peek(p).type != TK_NEWLINE) {
-        Pair *pair = parse_pair(p);
-        if(pair) {
-            arrayPush(&pairs, (void *)pair);
-        }
+    TRY_CONSUME(p, TK_RBRACKET);
+    if(!consume_line_end(p)) {
+        return NULL;
     }
-    return make_table(name, pairs);
+    return make_table(p, name);
 }
 
 #undef TRY_CONSUME
 
-// literal    -> STRING | NUMBER | BOOLEAN
-// pair       -> IDENTIFIER '=' literal
-// table      -> '[' IDENTIFIER ']' NEWLINE (pair)+
-// config     -> (table | pair)*
-bool config_parser_parse(char *source, Array *tables) {
+// statements
+
+// The parser is a state machine. Its state is the table that pairs are added to.
+// The statement that starts with the next token is a transition: it returns the next state.
+typedef ConfigTable *(*StatementFn)(Parser *p, Array *tables, ConfigTable *current);
+
+static ConfigTable *table_statement(Parser *p, Array *tables, ConfigTable *current) {
+    if(current != p->top_level) {
+        // a table ends with an empty line, so a header can't follow its pairs.
+        parser_error(p, "Expected an empty line before the table.");
+        synchronize(p);
+        return current;
+    }
+    ConfigTable *t = parse_table_header(p);
+    if(!t) {
+        // the pairs that follow an invalid header go to the top-level table.
+        synchronize(p);
+        return p->top_level;
+    }
+    arrayPush(tables, (void *)t);
+    return t;
+}
+
+static ConfigTable *pair_statement(Parser *p, Array *tables, ConfigTable *current) {
+    (void)tables; // unused
+    Pair *pair = parse_pair(p);
+    if(pair) {
+        arrayPush(&current->pairs, (void *)pair);
+    } else {
+        // parse_pair() doesn't always consume a token on failure.
+        synchronize(p);
+    }
+    return current;
+}
+
+// A newline that doesn't end a pair or a header is an empty line, which ends a table.
+static ConfigTable *empty_line_statement(Parser *p, Array *tables, ConfigTable *current) {
+    (void)tables; // unused
+    (void)current; // unused
+    skip_newlines(p);
+    return p->top_level;
+}
+
+static ConfigTable *invalid_statement(Parser *p, Array *tables, ConfigTable *current) {
+    (void)tables; // unused
+    parser_error(p, "Expected a table or a pair but got '%s'.", tokenTypeString(peek_type(p)));
+    advance_token(p); // so we don't get stuck in an infinite loop on the same token.
+    return current;
+}
+
+// The statement that starts with each token type.
+static const StatementFn statements[TK_EOF + 1] = {
+    [TK_LBRACKET] = table_statement,
+    [TK_RBRACKET] = invalid_statement,
+    [TK_EQUAL] = invalid_statement,
+    [TK_NEWLINE] = empty_line_statement,
+    [TK_NUMBER] = invalid_statement,
+    [TK_DATETIME] = invalid_statement,
+    [TK_DURATION] = invalid_statement,
+    [TK_SIZE] = invalid_statement,
+    [TK_TRUE] = invalid_statement,
+    [TK_FALSE] = invalid_statement,
+    [TK_STRING] = pair_statement,
+    [TK_IDENTIFIER] = pair_statement,
+    [TK_ERROR] = invalid_statement,
+    [TK_EOF] = invalid_statement
+};
+
+// literal    -> STRING | NUMBER | DATETIME | DURATION | SIZE | BOOLEAN
+// key        -> IDENTIFIER | STRING
+// pair       -> key '=' literal
+// table      -> '[' key ']' NEWLINE (pair)*
+// config     -> (table | pair | NEWLINE)*
+// An empty line ends a table, the pairs that follow it are top-level pairs.
+bool config_parser_parse(char *source, Array *tables, Arena *arena) {
     Scanner scanner;
     scannerInit(&scanner, source);
 
+    if(scanner.length > UINT32_MAX) {
+        fprintf(stderr, "Error: The source is larger than 4 GiB.\n");
+        scannerFree(&scanner);
+        return false;
+    }
+    size_t invalid = utf8Validate(scanner.source, scanner.length);
+    if(invalid != scanner.length) {
+        fprintf(stderr, "[line %d at %zu] Error: Invalid UTF-8.\n", scannerLine(&scanner, invalid), invalid);
+        scannerFree(&scanner);
+        return false;
+    }
+
     Parser p = {
         .scanner = &scanner,
-        .previous_token = {.type = TK_ERROR},
-        .current_token = {.type = TK_ERROR},
+        .arena = arena,
         .had_error = false
     };
+    // the previous token of the first one.
+    p.tokens[0] = tokenNew(TK_ERROR, 0);
+    p.current = p.end = p.tokens + 1;
+    refill(&p);
 
-    Array tmp;
-    arrayInit(&tmp);
-    ConfigTable *top_level = make_table(strdup("__toplevel__"), tmp);
-    arrayPush(tables, (void *)top_level);
+    p.top_level = make_table(&p, arenaStrndup(arena, "__toplevel__", strlen("__toplevel__")));
+    arrayPush(tables, (void *)p.top_level);
 
-    advance(&p);
-    // consume any newlines as they don't matter in the global scope.
-    skip_newlines(&p);
+    ConfigTable *current = p.top_level;
     while(!is_eof(&p)) {
-        switch(peek(&p).type) {
-            case TK_LBRACKET: {
-                ConfigTable *t = parse_table(&p);
-                if(t) {
-                    arrayPush(tables, (void *)t);
-                }
-                break;
-            }
-            case TK_IDENTIFIER: {
-                Pair *pair = parse_pair(&p);
-                if(pair) {
-                    arrayPush(&top_level->pairs, (void *)pair);
-                }
-                break;
-            }
-            default:
-                error(&p, "Only tables and pairs are allowed in the toplevel scope.");
-                advance(&p); // so we don't get stuck in an infinite loop on the same token.'
-                break;
-        }
-        // consume any remaining newlines.
-        skip_newlines(&p);
+        current = statements[peek_type(&p)](&p, tables, current);
     }
 
+    bool ok = !p.had_error && !scanner.had_error;
     scannerFree(&scanner);
-    return !p.had_error;
+    return ok;
 }
@@ -0,0 +1,174 @@
+#include <stdlib.h>
+#include <string.h> // strlen, memset
+#include <stdint.h>
+#include <stdbool.h>
+#include "hash.h"
+#include "phf.h"
+
+// Give up on a seed when a bucket needs more displacements than this.
+#define MAX_DISPLACEMENT (1u << 24)
+#define MAX_SEEDS 16
+
+static inline size_t slot_of(uint64_t hash, uint32_t displacement, size_t size) {
+    return hashReduce(hashMix(hash ^ ((uint64_t)displacement * 0x9e3779b97f4a7c15ull)), size);
+}
+
+// The buffers of a build, reused by every seed.
+typedef struct phf_scratch {
+    uint64_t *hashes; // the hash of every key.
+    size_t *bucket_start; // the start of every bucket in 'sorted_hashes'.
+    uint64_t *sorted_hashes; // the hashes grouped by bucket, the largest buckets first.
+    size_t *sorted_keys; // the index of the key of every hash in 'sorted_hashes'.
+    uint64_t *taken; // a bit per slot.
+} PhfScratch;
+
+static inline bool is_taken(const uint64_t *taken, size_t slot) {
+    return taken[slot / 64] & (1ull << (slot % 64));
+}
+
+// Try to place every bucket using the hashes of the keys.
+// On success key_slots[i] is the slot of the i-th key.
+static bool place_buckets(Phf *phf, PhfScratch *s, size_t *key_slots) {
+    size_t n = phf->size + PHF_EXTRA_SLOTS(phf->size), buckets = phf->bucket_count;
+    size_t *start = s->bucket_start;
+
+    // the size of every bucket.
+    memset(start, 0, buckets * sizeof(*start));
+    for(size_t i = 0; i < phf->size; ++i) {
+        start[hashReduce(s->hashes[i], buckets)]++;
+    }
+    size_t max_bucket_size = 0;
+    for(size_t b = 0; b < buckets; ++b) {
+        if(start[b] > max_bucket_size) {
+            max_bucket_size = start[b];
+        }
+    }
+
+    // The buckets are laid out by size, largest first as they are the hardest to place,
+    // so they are placed in one pass over 'sorted_hashes' instead of jumping between buckets.
+    // 'cursor' holds the start of the next bucket of every size, 'placed' the slots of the bucket being placed.
+    size_t *cursor = calloc(2 * (max_bucket_size + 1), sizeof(*cursor));
+    if(!cursor) {
+        return false;
+    }
+    size_t *placed = cursor + max_bucket_size + 1;
+    for(size_t b = 0; b < buckets; ++b) {
+        cursor[start[b]] += start[b];
+    }
+    for(size_t size = max_bucket_size, offset = 0; size > 0; --size) {
+        size_t keys = cursor[size];
+        cursor[size] = offset;
+        offset += keys;
+    }
+    for(size_t b = 0; b < buckets; ++b) {
+        size_t size = start[b];
+        start[b] = cursor[size];
+        cursor[size] += size;
+    }
+    for(size_t i = 0; i < phf->size; ++i) {
+        size_t *next = &start[hashReduce(s->hashes[i], buckets)];
+        s->sorted_hashes[*next] = s->hashes[i];
+        s->sorted_keys[*next] = i;
+        (*next)++;
+    }
+
+    // cursor[size] is now the end of the buckets of that size.
+    memset(s->taken, 0, ((n + 63) / 64) * sizeof(*s->taken));
+    size_t first = 0;
+    for(size_t size = max_bucket_size; size > 0; --size) {
+        for(; first < cursor[size]; first += size) {
+            const uint64_t *hashes = s->sorted_hashes + first;
+            uint32_t d = 0;
+            for(;;) {
+                size_t count = 0;
+                for(; count < size; ++count) {
+                    size_t slot = slot_of(hashes[count], d, n);
+                    if(is_taken(s->taken, slot)) {
+                        break;
+                    }
+                    s->taken[slot / 64] |= 1ull << (slot % 64);
+                    placed[count] = slot;
+                }
+                if(count == size) {
+                    break;
+                }
+                // undo the partial placement and try the next displacement.
+                for(size_t j = 0; j < count; ++j) {
+                    s->taken[placed[j] / 64] &= ~(1ull << (placed[j] % 64));
+                }
+                if(++d == MAX_DISPLACEMENT) {
+                    free(cursor);
+                    return false;
+                }
+            }
+            phf->displacements[hashReduce(hashes[0], buckets)] = d;
+            for(size_t j = 0; j < size; ++j) {
+                key_slots[s->sorted_keys[first + j]] = placed[j];
+            }
+        }
+    }
+    free(cursor);
+
+    // move the keys in the extra slots to the free slots.
+    size_t free_slot = 0;
+    for(size_t slot = phf->size; slot < n; ++slot) {
+        if(!is_taken(s->taken, slot)) {
+            continue;
+        }
+        while(is_taken(s->taken, free_slot)) {
+            free_slot++;
+        }
+        phf->remap[slot - phf->size] = (uint32_t)free_slot++;
+    }
+    for(size_t i = 0; i < phf->size; ++i) {
+        if(key_slots[i] >= phf->size) {
+            key_slots[i] = phf->remap[key_slots[i] - phf->size];
+        }
+    }
+    return true;
+}
+
+bool phfBuild(Phf *phf, const char **keys, size_t count, size_t *key_slots) {
+    phf->size = count;
+    phf->bucket_count = count / PHF_BUCKET_SIZE + 1;
+    size_t slot_count = count + PHF_EXTRA_SLOTS(count);
+    phf->displacements = calloc(phf->bucket_count, sizeof(*phf->displacements));
+    phf->remap = calloc(PHF_EXTRA_SLOTS(count), sizeof(*phf->remap));
+    PhfScratch s = {
+        .hashes = malloc(count * sizeof(*s.hashes) + 1),
+        .bucket_start = malloc(phf->bucket_count * sizeof(*s.bucket_start)),
+        .sorted_hashes = malloc(count * sizeof(*s.sorted_hashes) + 1),
+        .sorted_keys = malloc(count * sizeof(*s.sorted_keys) + 1),
+        .taken = malloc(((slot_count + 63) / 64) * sizeof(*s.taken))
+    };
+
+    bool ok = false;
+    if(phf->displacements && phf->remap && s.hashes && s.bucket_start && s.sorted_hashes && s.sorted_keys && s.taken) {
+        // the keys are hashed once per seed, and almost always only the first seed is used.
+        for(uint64_t attempt = 0; attempt < MAX_SEEDS && !ok; ++attempt) {
+            phf->seed = hashMix(attempt + 1);
+            for(size_t i = 0; i < count; ++i) {
+                s.hashes[i] = hashBytes(keys[i], strlen(keys[i]), phf->seed);
+            }
+            ok = place_buckets(phf, &s, key_slots);
+        }
+    }
+
+    free(s.hashes);
+    free(s.bucket_start);
+    free(s.sorted_hashes);
+    free(s.sorted_keys);
+    free(s.taken);
+    if(!ok) {
+        phfFree(phf);
+    }
+    return ok;
+}
+
+void phfFree(Phf *phf) {
+    free(phf->displacements);
+    free(phf->remap);
+    phf->displacements = NULL;
+    phf->remap = NULL;
+    phf->size = phf->bucket_count = 0;
+}
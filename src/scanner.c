@@ -1,5 +1,5 @@
 #include <stdio.h>
-#include <stdlib.h> // strtol, size_t
+#include <stdlib.h> // size_t
 #include <string.h> // memcmp
 #include <stdarg.h>
 #include <assert.h>
@@ -8,16 +8,24 @@
 #include "token.h"
 #include "scanner.h"
 
+#if defined(__SSE2__) && !defined(CONFIG_PARSER_NO_SIMD)
+#include <emmintrin.h>
+#define USE_SSE2
+#endif
+
 void scannerInit(Scanner *s, char *source) {
     s->source = source;
+    s->length = strlen(source);
     s->start = s->current = 0;
+    s->had_error = false;
+    s->line_at = 0;
     s->line = 1;
 }
 
 void scannerFree(Scanner *s) {
     s->source = NULL;
+    s->length = 0;
     s->start = s->current = 0;
-    s->line = 0;
 }
 
 // helpers
@@ -30,9 +38,39 @@ static inline bool isAscii(char c) {
     return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z');
 }
 
+static inline bool isHexDigit(char c) {
+    return isDigit(c) || (c >= 'a' && c <= 'f') || (c >= 'A' && c <= 'F');
+}
+
+// [A-Za-z0-9_], looked up in a table as it is tested for every character of keys.
+// Written out byte by byte, one row of 16 per line, as range designators aren't standard C.
+static const bool identifier_chars[256] = {
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, // 0x00
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, // 0x10
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, // 0x20
+    1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 0, 0, 0, 0, 0, 0, // 0x30
+    0, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, // 0x40
+    1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 0, 0, 0, 0, 1, // 0x50
+    0, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, // 0x60
+    1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 0, 0, 0, 0, 0, // 0x70
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, // 0x80
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, // 0x90
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, // 0xa0
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, // 0xb0
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, // 0xc0
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, // 0xd0
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, // 0xe0
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, // 0xf0
+};
+
+static inline bool isIdentifierChar(char c) {
+    return identifier_chars[(unsigned char)c];
+}
+
 static void error(Scanner *s, const char *format, ...) {
     va_list ap;
-    fprintf(stderr, "[line %d at %zu] Error: ", s->line, s->current);
+    s->had_error = true;
+    fprintf(stderr, "[line %d at %zu] Error: ", scannerLine(s, s->current), s->current);
     va_start(ap, format);
     vfprintf(stderr, format, ap);
     va_end(ap);
@@ -40,7 +78,7 @@ static void error(Scanner *s, const char *format, ...) {
 }
 
 static inline Token make_token(Scanner *s, TokenType type) {
-    return tokenNew(type, s->line, s->start);
+    return tokenNew(type, (uint32_t)s->start);
 }
 
 static inline bool is_end(Scanner *s) {
@@ -55,6 +93,22 @@ static inline char peek(Scanner *s) {
     return s->source[s->current];
 }
 
+static inline char peek_next(Scanner *s) {
+    if(is_end(s)) {
+        return '\0';
+    }
+    return s->source[s->current + 1];
+}
+
+// Whether only whitespace precedes the current character on its line.
+static bool at_line_start(Scanner *s) {
+    size_t i = s->current;
+    while(i > 0 && (s->source[i - 1] == ' ' || s->source[i - 1] == '\t' || s->source[i - 1] == '\r')) {
+        i--;
+    }
+    return i == 0 || s->source[i - 1] == '\n';
+}
+
 static void skip_whitespace(Scanner *s) {
     for(;;) {
         switch(peek(s)) {
@@ -63,32 +117,293 @@ static void skip_whitespace(Scanner *s) {
             case '\t':
                 advance(s);
                 break;
-            case '#':
+            case '#': {
                 // comment, skip until end of line.
+                bool own_line = at_line_start(s);
                 while(!is_end(s) && peek(s) != '\n') {
                     advance(s);
                 }
-                advance(s); // consume the newline
+                // the newline after a comment that follows a token ends the line of that token,
+                // a line with only a comment is skipped with its newline so it doesn't end a table.
+                if(own_line && !is_end(s)) {
+                    advance(s);
+                }
                 break;
+            }
             default:
                 return;
         }
     }
 }
 
+static inline bool match_char(Scanner *s, char c) {
+    if(peek(s) != c) {
+        return false;
+    }
+    advance(s);
+    return true;
+}
+
+// Scan exactly 'count' digits.
+static bool scan_digits(Scanner *s, int count, int *value) {
+    int result = 0;
+    for(int i = 0; i < count; ++i) {
+        if(!isDigit(peek(s))) {
+            return false;
+        }
+        result = result * 10 + (advance(s) - '0');
+    }
+    *value = result;
+    return true;
+}
+
+// DIGITS -> [0-9] ('_'? [0-9])*
+// Like in TOML, an underscore has to be between two digits.
+// The only scanner of integers of any length, used for numbers, durations and sizes.
+// Reports malformed digits, but leaves reporting 'overflow' to the caller.
+static bool scan_integer(Scanner *s, int64_t *value, bool *overflow) {
+    int64_t result = 0;
+    *overflow = false;
+    if(!isDigit(peek(s))) {
+        error(s, "Expected a digit.");
+        return false;
+    }
+    for(;;) {
+        if(match_char(s, '_') && !isDigit(peek(s))) {
+            error(s, "An underscore in a number has to be between two digits.");
+            return false;
+        }
+        if(!isDigit(peek(s))) {
+            break;
+        }
+        *overflow |= __builtin_mul_overflow(result, 10, &result) || __builtin_add_overflow(result, advance(s) - '0', &result);
+    }
+    *value = result;
+    return true;
+}
+
+static inline bool is_leap_year(int year) {
+    return year % 4 == 0 && (year % 100 != 0 || year % 400 == 0);
+}
+
+static int days_in_month(int year, int month) {
+    static const int days[] = {31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31};
+    return month == 2 && is_leap_year(year) ? 29 : days[month - 1];
+}
+
+// Days since 1970-01-01 (proleptic Gregorian calendar).
+static int64_t days_from_civil(int64_t year, int month, int day) {
+    year -= month <= 2;
+    int64_t era = (year >= 0 ? year : year - 399) / 400;
+    int64_t year_of_era = year - era * 400;
+    int64_t day_of_year = (153 * (month > 2 ? month - 3 : month + 9) + 2) / 5 + day - 1;
+    int64_t day_of_era = year_of_era * 365 + year_of_era / 4 - year_of_era / 100 + day_of_year;
+    return era * 146097 + day_of_era - 719468;
+}
+
+// TIME -> HH ':' MM ':' SS ('.' DIGITS)?
+// Digits after the 9th fractional digit are ignored.
+static bool scan_time(Scanner *s, int64_t *nanoseconds) {
+    int hour, minute, second;
+    if(!(scan_digits(s, 2, &hour) && match_char(s, ':') &&
+         scan_digits(s, 2, &minute) && match_char(s, ':') &&
+         scan_digits(s, 2, &second))) {
+        error(s, "Invalid time, expected HH:MM:SS.");
+        return false;
+    }
+    // 60 is a leap second.
+    if(hour > 23 || minute > 59 || second > 60) {
+        error(s, "Invalid time.");
+        return false;
+    }
+    int64_t result = (hour * 3600 + minute * 60 + second) * 1000000000LL;
+    if(match_char(s, '.')) {
+        if(!isDigit(peek(s))) {
+            error(s, "Expected digits after the decimal point.");
+            return false;
+        }
+        for(int64_t scale = 100000000; isDigit(peek(s)); scale /= 10) {
+            result += (advance(s) - '0') * scale;
+        }
+    }
+    *nanoseconds = result;
+    return true;
+}
+
+// datetime -> DATE ([Tt ] TIME OFFSET?)?
+// DATE     -> YYYY '-' MM '-' DD
+// OFFSET   -> [Zz] | [+-] HH ':' MM
+// Dates and datetimes without an offset are in UTC.
+// The value is in nanoseconds since the Unix epoch.
+static Token scan_datetime(Scanner *s) {
+    int year, month, day, offset = 0;
+    int64_t time = 0;
+    s->current = s->start;
+    if(!(scan_digits(s, 4, &year) && match_char(s, '-') &&
+         scan_digits(s, 2, &month) && match_char(s, '-') &&
+         scan_digits(s, 2, &day))) {
+        error(s, "Invalid date, expected YYYY-MM-DD.");
+        return make_token(s, TK_ERROR);
+    }
+    if(month < 1 || month > 12 || day < 1 || day > days_in_month(year, month)) {
+        error(s, "Invalid date.");
+        return make_token(s, TK_ERROR);
+    }
+    // a space only separates the date and the time if a time follows it.
+    char c = peek(s);
+    if(c == 'T' || c == 't' || (c == ' ' && isDigit(peek_next(s)) && isDigit(s->source[s->current + 2]) && s->source[s->current + 3] == ':')) {
+        advance(s);
+        if(!scan_time(s, &time)) {
+            return make_token(s, TK_ERROR);
+        }
+        if(match_char(s, 'Z') || match_char(s, 'z')) {
+            // UTC
+        } else if(peek(s) == '+' || peek(s) == '-') {
+            int sign = advance(s) == '-' ? -1 : 1;
+            int offset_hour, offset_minute;
+            if(!(scan_digits(s, 2, &offset_hour) && match_char(s, ':') && scan_digits(s, 2, &offset_minute)) ||
+               offset_hour > 23 || offset_minute > 59) {
+                error(s, "Invalid UTC offset, expected +HH:MM or -HH:MM.");
+                return make_token(s, TK_ERROR);
+            }
+            offset = sign * (offset_hour * 60 + offset_minute);
+        }
+    }
+    if(isIdentifierChar(peek(s))) {
+        error(s, "Unexpected character '%c' in datetime.", peek(s));
+        return make_token(s, TK_ERROR);
+    }
+    int64_t seconds = days_from_civil(year, month, day) * 86400 + time / 1000000000 - offset * 60;
+    // int64_t nanoseconds cover the years 1678 to 2262.
+    if(seconds <= INT64_MIN / 1000000000 || seconds >= INT64_MAX / 1000000000) {
+        error(s, "Datetime out of range.");
+        return make_token(s, TK_ERROR);
+    }
+    Token tk = make_token(s, TK_DATETIME);
+    tk.as.number = seconds * 1000000000 + time % 1000000000;
+    return tk;
+}
+
+// local time -> TIME
+// A time without a date is a datetime on 1970-01-01 (UTC), so its value is in nanoseconds since midnight.
+static Token scan_local_time(Scanner *s) {
+    int64_t time;
+    s->current = s->start;
+    if(!scan_time(s, &time)) {
+        return make_token(s, TK_ERROR);
+    }
+    if(isIdentifierChar(peek(s))) {
+        error(s, "Unexpected character '%c' in time.", peek(s));
+        return make_token(s, TK_ERROR);
+    }
+    Token tk = make_token(s, TK_DATETIME);
+    tk.as.number = time;
+    return tk;
+}
+
+typedef struct unit {
+    const char *name;
+    uint8_t length;
+    TokenType type;
+    int64_t scale;
+} Unit;
+
+static const Unit units[] = {
+    {"ns", 2, TK_DURATION, 1},
+    {"us", 2, TK_DURATION, 1000},
+    {"ms", 2, TK_DURATION, 1000000},
+    {"s", 1, TK_DURATION, 1000000000},
+    {"m", 1, TK_DURATION, 60 * 1000000000LL},
+    {"h", 1, TK_DURATION, 3600 * 1000000000LL},
+    {"d", 1, TK_DURATION, 86400 * 1000000000LL},
+    {"B", 1, TK_SIZE, 1},
+    {"KB", 2, TK_SIZE, 1000},
+    {"MB", 2, TK_SIZE, 1000 * 1000},
+    {"GB", 2, TK_SIZE, 1000 * 1000 * 1000},
+    {"TB", 2, TK_SIZE, 1000 * 1000 * 1000 * 1000LL},
+    {"KiB", 3, TK_SIZE, 1LL << 10},
+    {"MiB", 3, TK_SIZE, 1LL << 20},
+    {"GiB", 3, TK_SIZE, 1LL << 30},
+    {"TiB", 3, TK_SIZE, 1LL << 40}
+};
+
+static const Unit *find_unit(const char *name, size_t length) {
+    for(size_t i = 0; i < sizeof(units) / sizeof(units[0]); ++i) {
+        if(units[i].length == length && memcmp(units[i].name, name, length) == 0) {
+            return &units[i];
+        }
+    }
+    return NULL;
+}
+
+// duration -> (DIGITS ('ns' | 'us' | 'ms' | 's' | 'm' | 'h' | 'd'))+
+// size     -> DIGITS ('B' | 'KB' | 'MB' | 'GB' | 'TB' | 'KiB' | 'MiB' | 'GiB' | 'TiB')
+// Durations are in nanoseconds and sizes in bytes.
+static Token scan_quantity(Scanner *s) {
+    TokenType type = TK_ERROR;
+    int64_t total = 0;
+    s->current = s->start;
+    do {
+        int64_t value;
+        bool overflow;
+        if(!scan_integer(s, &value, &overflow)) {
+            return make_token(s, TK_ERROR);
+        }
+        size_t unit_start = s->current;
+        while(isAscii(peek(s))) {
+            advance(s);
+        }
+        const Unit *unit = find_unit(s->source + unit_start, s->current - unit_start);
+        if(!unit) {
+            error(s, "Unknown unit '%.*s'.", (int)(s->current - unit_start), s->source + unit_start);
+            return make_token(s, TK_ERROR);
+        }
+        if(type != TK_ERROR && (type == TK_SIZE || unit->type == TK_SIZE)) {
+            error(s, "Only durations can have more than one unit.");
+            return make_token(s, TK_ERROR);
+        }
+        type = unit->type;
+        if(overflow || __builtin_mul_overflow(value, unit->scale, &value) || __builtin_add_overflow(total, value, &total)) {
+            error(s, "%s out of range.", type == TK_SIZE ? "Size" : "Duration");
+            return make_token(s, TK_ERROR);
+        }
+    } while(isDigit(peek(s)));
+    Token tk = make_token(s, type);
+    tk.as.number = total;
+    return tk;
+}
+
+// number -> DIGITS
 static Token scan_number(Scanner *s) {
     // TODO: add hex, octal, and binary literals.
-    while(!is_end(s) && (isDigit(peek(s)) || peek(s) == '_')) {
-        advance(s);
+    int64_t value;
+    bool overflow;
+    s->current = s->start;
+    if(!scan_integer(s, &value, &overflow)) {
+        return make_token(s, TK_ERROR);
+    }
+    size_t length = s->current - s->start;
+    if(length == 4 && peek(s) == '-') {
+        return scan_datetime(s);
+    }
+    if(length == 2 && peek(s) == ':') {
+        return scan_local_time(s);
+    }
+    if(isAscii(peek(s))) {
+        return scan_quantity(s);
+    }
+    if(overflow) {
+        error(s, "Number out of range.");
+        return make_token(s, TK_ERROR);
     }
-    int64_t value = strtol(&s->source[s->start], NULL, 10);
     Token tk = make_token(s, TK_NUMBER);
     tk.as.number = value;
     return tk;
 }
 
 static TokenType scan_boolean_or_identifier_type(Scanner *s) {
-    while(!is_end(s) && (isAscii(peek(s)) || isDigit(peek(s)) || peek(s) == '_')) {
+    // the NUL terminator isn't an identifier character.
+    while(isIdentifierChar(peek(s))) {
         advance(s);
     }
     char *lexeme = s->source + s->start;
@@ -103,7 +418,166 @@ static TokenType scan_boolean_or_identifier_type(Scanner *s) {
     return TK_IDENTIFIER;
 }
 
-Token scan_token(Scanner *s) {
+// Advance over the bytes of a string that don't need special handling:
+// anything but the quote, a backslash, a newline or the end of the source.
+static void skip_string_bytes(Scanner *s, char quote) {
+#ifdef USE_SSE2
+    const __m128i q = _mm_set1_epi8(quote);
+    const __m128i backslash = _mm_set1_epi8('\\');
+    const __m128i newline = _mm_set1_epi8('\n');
+    const __m128i nul = _mm_setzero_si128();
+    while(s->current + 16 <= s->length) {
+        __m128i block = _mm_loadu_si128((const __m128i *)(s->source + s->current));
+        __m128i special = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(block, q), _mm_cmpeq_epi8(block, backslash)),
+                                       _mm_or_si128(_mm_cmpeq_epi8(block, newline), _mm_cmpeq_epi8(block, nul)));
+        int mask = _mm_movemask_epi8(special);
+        if(mask) {
+            s->current += __builtin_ctz(mask);
+            return;
+        }
+        s->current += 16;
+    }
+#endif
+    for(;;) {
+        char c = peek(s);
+        if(c == quote || c == '\\' || c == '\n' || c == '\0') {
+            return;
+        }
+        advance(s);
+    }
+}
+
+// Validate the escape sequence following a backslash.
+static bool scan_escape(Scanner *s, bool multiline) {
+    char c = peek(s);
+    int digits = 0;
+    switch(c) {
+        case 'b': case 't': case 'n': case 'f': case 'r': case '"': case '\\':
+            advance(s);
+            return true;
+        case 'u': digits = 4; break;
+        case 'U': digits = 8; break;
+        case ' ': case '\t': case '\r': case '\n':
+            if(multiline) {
+                // line ending backslash, only whitespace may follow it on the same line.
+                while(peek(s) == ' ' || peek(s) == '\t' || peek(s) == '\r') {
+                    advance(s);
+                }
+                if(peek(s) == '\n') {
+                    return true;
+                }
+            }
+            error(s, "Invalid escape sequence.");
+            return false;
+        case '\0':
+            // a backslash at the end of the source, scan_string() reports the unterminated string.
+            return false;
+        default:
+            if(c > ' ' && c < 0x7f) {
+                error(s, "Invalid escape sequence '\\%c'.", c);
+            } else {
+                error(s, "Invalid escape sequence.");
+            }
+            return false;
+    }
+    advance(s); // the 'u' or 'U'
+    uint32_t codepoint = 0;
+    for(int i = 0; i < digits; ++i) {
+        if(!isHexDigit(peek(s))) {
+            error(s, "Expected %d hex digits in unicode escape sequence.", digits);
+            return false;
+        }
+        char h = advance(s);
+        codepoint = (codepoint << 4) | (uint32_t)(isDigit(h) ? h - '0' : (h | 0x20) - 'a' + 10);
+    }
+    if(codepoint > 0x10FFFF || (codepoint >= 0xD800 && codepoint <= 0xDFFF)) {
+        error(s, "Escape sequence is not a valid unicode scalar value.");
+        return false;
+    }
+    // the strings are NUL terminated, so a NUL would silently truncate them.
+    if(codepoint == 0) {
+        error(s, "Strings can't contain a NUL character.");
+        return false;
+    }
+    return true;
+}
+
+// basic string      -> '"' (CHAR | ESCAPE)* '"'
+// literal string    -> "'" CHAR* "'"
+// multi-line string -> '"""' ... '"""' | "'''" ... "'''"
+// The token is a slice of the source without the quotes,
+// strings that have escape sequences are decoded by the parser.
+// After an invalid escape sequence the rest of the string is skipped (without reporting
+// the escape sequences that follow), so scanning resumes after the closing quote.
+static Token scan_string(Scanner *s, char quote) {
+    bool multiline = false;
+    bool has_escapes = false;
+    bool valid = true;
+    if(peek(s) == quote && peek_next(s) == quote) {
+        advance(s);
+        advance(s);
+        multiline = true;
+        // a newline immediately following the opening delimiter is trimmed.
+        if(peek(s) == '\r' && peek_next(s) == '\n') {
+            advance(s);
+        }
+        if(peek(s) == '\n') {
+            advance(s);
+        }
+    }
+    size_t content_start = s->current, content_end;
+    for(;;) {
+        skip_string_bytes(s, quote);
+        char c = peek(s);
+        if(c == '\0' || (c == '\n' && !multiline)) {
+            error(s, "Unterminated string.");
+            return make_token(s, TK_ERROR);
+        }
+        if(c == '\n') {
+            advance(s);
+        } else if(c == '\\') {
+            advance(s);
+            if(quote == '"') {
+                has_escapes = true;
+                if(valid) {
+                    valid = scan_escape(s, multiline);
+                } else if(peek(s) == quote || peek(s) == '\\') {
+                    // an escaped quote doesn't end the string.
+                    advance(s);
+                }
+            }
+        } else if(!multiline) {
+            content_end = s->current;
+            advance(s); // the closing quote
+            break;
+        } else {
+            // up to 2 quotes are allowed right before the closing delimiter.
+            size_t quotes = 0;
+            while(peek(s) == quote) {
+                advance(s);
+                quotes++;
+            }
+            if(quotes >= 3) {
+                if(quotes > 5) {
+                    error(s, "Too many quotes at the end of a multi-line string.");
+                    return make_token(s, TK_ERROR);
+                }
+                content_end = s->current - 3;
+                break;
+            }
+        }
+    }
+    if(!valid) {
+        return make_token(s, TK_ERROR);
+    }
+    Token tk = make_token(s, TK_STRING);
+    tk.flags = has_escapes ? TOKEN_HAS_ESCAPES : 0;
+    tk.as.slice.start = (uint32_t)content_start;
+    tk.as.slice.length = (uint32_t)(content_end - content_start);
+    return tk;
+}
+
+static Token scan_token(Scanner *s) {
     skip_whitespace(s);
     s->start = s->current;
     if(is_end(s)) {
@@ -116,8 +590,8 @@ Token scan_token(Scanner *s) {
     }
     if(isAscii(c) || c == '_') {
         Token tk = make_token(s, scan_boolean_or_identifier_type(s));
-        tk.as.string_or_id.txt = s->source + s->start;
-        tk.as.string_or_id.length = s->current - s->start;
+        tk.as.slice.start = (uint32_t)s->start;
+        tk.as.slice.length = (uint32_t)(s->current - s->start);
         return tk;
     }
 
@@ -126,22 +600,20 @@ Token scan_token(Scanner *s) {
         case ']': return make_token(s, TK_RBRACKET);
         case '=': return make_token(s, TK_EQUAL);
         case '\n': return make_token(s, TK_NEWLINE);
-        case '"': {
-            while(!is_end(s) && peek(s) != '"') {
-                advance(s);
-            }
-            // consume the last double-quote.
-            advance(s);
-            Token tk = make_token(s, TK_STRING);
-            // + 1 to trim the leading double-quote
-            tk.as.string_or_id.txt = s->source + s->start + 1;
-            // - 2 to trim the double-quotes.
-            tk.as.string_or_id.length = (int)(s->current - s->start - 2);
-            return tk;
-        }
+        case '"':
+        case '\'':
+            return scan_string(s, c);
         default:
             break;
     }
+    if((unsigned char)c >= 0x80) {
+        // the source is valid UTF-8, so skip the rest of the character.
+        while(((unsigned char)peek(s) & 0xC0) == 0x80) {
+            advance(s);
+        }
+        error(s, "Non-ASCII characters are only allowed in strings and comments (use a quoted key).");
+        return make_token(s, TK_ERROR);
+    }
     error(s, "Unknown character '%c'", c);
     return make_token(s, TK_ERROR);
 }
@@ -149,7 +621,48 @@ Token scan_token(Scanner *s) {
 
 Token scannerNextToken(Scanner *s) {
     if(!s->source) {
-        return tokenNew(TK_EOF, 0, 0);
+        return tokenNew(TK_EOF, 0);
     }
     return scan_token(s);
 }
+
+size_t scannerScan(Scanner *s, Token *tokens, size_t capacity) {
+    if(!s->source) {
+        tokens[0] = tokenNew(TK_EOF, 0);
+        return 1;
+    }
+    size_t count = 0;
+    while(count < capacity) {
+        Token tk = scan_token(s);
+        if(tk.type == TK_ERROR) {
+            continue;
+        }
+        tokens[count++] = tk;
+        if(tk.type == TK_EOF) {
+            break;
+        }
+    }
+    return count;
+}
+
+static int count_newlines(const char *p, const char *end) {
+    int count = 0;
+    while((p = memchr(p, '\n', end - p)) != NULL) {
+        count++;
+        p++;
+    }
+    return count;
+}
+
+int scannerLine(Scanner *s, size_t at) {
+    if(at > s->length) {
+        at = s->length;
+    }
+    if(at >= s->line_at) {
+        s->line += count_newlines(s->source + s->line_at, s->source + at);
+    } else {
+        s->line -= count_newlines(s->source + at, s->source + s->line_at);
+    }
+    s->line_at = at;
+    return s->line;
+}
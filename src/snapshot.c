@@ -0,0 +1,476 @@
+#include <stdio.h> // snprintf, renameat
+#include <stdlib.h>
+#include <string.h> // strlen, memcpy, memcmp
+#include <inttypes.h> // PRIx64
+#include <limits.h> // PATH_MAX
+#include <time.h>
+#include <errno.h>
+#include <dirent.h> // fdopendir
+#include <fcntl.h> // open, openat
+#include <unistd.h> // write, close, unlinkat, geteuid, getpid
+#include <sys/mman.h> // mmap
+#include <sys/stat.h>
+#include "array.h"
+#include "arena.h"
+#include "hash.h"
+#include "parser.h"
+#include "config_internal.h"
+#include "snapshot.h"
+
+// Layout of a snapshot: the header, the tables, the pairs of all the tables
+// (in the order of the tables), the strings, all NUL terminated, and the absolute path of the
+// file (NUL terminated).
+// The header identifies the version of the file the snapshot was made from by its device, inode,
+// size and mtime, and by a hash of its contents, which all have to match before the snapshot is used.
+// Strings are referred to by their offset in the strings.
+// The sizes of the structures are multiples of 8, so the tables and the pairs are
+// aligned in the mapping of the snapshot.
+
+#define SNAPSHOT_MAGIC "CFGSNAP"
+#define SNAPSHOT_VERSION 4
+// written in the byte order of the writer, so snapshots of other byte orders are ignored.
+#define SNAPSHOT_BYTE_ORDER 0x01020304u
+// the seed of the checksum of everything after the header.
+#define SNAPSHOT_CHECKSUM_SEED 0x636865636b73756dull
+// the seed of the hash of the contents of the file.
+#define SNAPSHOT_CONTENT_SEED 0x636f6e74656e7473ull
+// the flags of a table.
+#define SNAPSHOT_DISTINCT_KEYS 1u // ConfigTable.distinct_keys
+// temporary files older than this (in seconds) were left by a writer that died.
+#define SNAPSHOT_TEMP_AGE 60
+
+typedef struct snapshot_header {
+    char magic[8];
+    uint32_t version;
+    uint32_t byte_order;
+    uint64_t path_length;
+    // the file the snapshot was made from.
+    uint64_t device, inode;
+    uint64_t content_length;
+    int64_t mtime_sec, mtime_nsec;
+    uint64_t content_hash;
+    uint64_t size; // the size of the whole snapshot.
+    uint64_t checksum;
+    uint32_t table_count, pair_count;
+    uint64_t strings_length;
+} SnapshotHeader;
+
+typedef struct snapshot_table {
+    uint32_t name;
+    uint32_t pair_count;
+    uint32_t flags;
+    uint32_t reserved; // zero.
+} SnapshotTable;
+
+typedef struct snapshot_pair {
+    uint32_t key;
+    uint32_t type; // LiteralType
+    int64_t value; // the offset of the string for strings.
+} SnapshotPair;
+
+_Static_assert(sizeof(SnapshotHeader) % 8 == 0 && sizeof(SnapshotTable) % 8 == 0 && sizeof(SnapshotPair) % 8 == 0,
+               "the snapshot structures have to stay aligned");
+
+// The name of the snapshot of a file in the cache directory, from its absolute path,
+// so a new snapshot of a file that changed replaces the previous one.
+#define SNAPSHOT_NAME_SIZE sizeof("0123456789abcdef.snapshot")
+
+static void snapshot_name(char *name, const char *absolute_path) {
+    snprintf(name, SNAPSHOT_NAME_SIZE, "%016" PRIx64 ".snapshot", hashBytes(absolute_path, strlen(absolute_path), SNAPSHOT_SEED));
+}
+
+// The path isn't normalized, a file reached through different paths has a snapshot for each of them.
+static bool absolute_path(char *absolute, const char *path) {
+    size_t used = 0;
+    if(path[0] != '/') {
+        if(!getcwd(absolute, PATH_MAX)) {
+            return false;
+        }
+        used = strlen(absolute);
+    }
+    int length = snprintf(absolute + used, PATH_MAX - used, "%s%s", path[0] != '/' ? "/" : "", path);
+    return length > 0 && (size_t)length < PATH_MAX - used;
+}
+
+static inline bool has_suffix(const char *s, const char *suffix) {
+    size_t length = strlen(s), suffix_length = strlen(suffix);
+    return length > suffix_length && !strcmp(s + length - suffix_length, suffix);
+}
+
+int snapshotOpenDir(const char *dir) {
+    int fd = open(dir, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if(fd < 0) {
+        return -1;
+    }
+    struct stat st;
+    if(fstat(fd, &st) < 0) {
+        int saved_errno = errno;
+        close(fd);
+        errno = saved_errno;
+        return -1;
+    }
+    // a snapshot is used instead of the file it was made from,
+    // so nobody else may be able to write one.
+    if(st.st_uid != geteuid() || (st.st_mode & (S_IWGRP | S_IWOTH))) {
+        close(fd);
+        errno = EACCES;
+        return -1;
+    }
+    return fd;
+}
+
+/* loading */
+
+// Check everything the loader relies on, so a corrupt snapshot can't make it read out of bounds.
+static bool snapshot_valid(const char *data, size_t size) {
+    if(size < sizeof(SnapshotHeader)) {
+        return false;
+    }
+    const SnapshotHeader *header = (const SnapshotHeader *)data;
+    if(memcmp(header->magic, SNAPSHOT_MAGIC, sizeof(header->magic)) != 0 ||
+       header->version != SNAPSHOT_VERSION ||
+       header->byte_order != SNAPSHOT_BYTE_ORDER ||
+       header->size != size) {
+        return false;
+    }
+    // the counts are 32-bit, so this can't overflow.
+    uint64_t fixed = sizeof(SnapshotHeader) + (uint64_t)header->table_count * sizeof(SnapshotTable) +
+                     (uint64_t)header->pair_count * sizeof(SnapshotPair);
+    if(fixed > size) {
+        return false;
+    }
+    // what is left for the strings and the path.
+    uint64_t rest = size - fixed;
+    if(header->path_length >= rest) {
+        return false;
+    }
+    rest -= header->path_length + 1;
+    if(header->strings_length != rest || header->strings_length == 0 || header->table_count == 0) {
+        return false;
+    }
+    if(hashBytes(data + sizeof(SnapshotHeader), size - sizeof(SnapshotHeader), SNAPSHOT_CHECKSUM_SEED) != header->checksum) {
+        return false;
+    }
+
+    const SnapshotTable *tables = (const SnapshotTable *)(data + sizeof(SnapshotHeader));
+    const SnapshotPair *pairs = (const SnapshotPair *)(tables + header->table_count);
+    const char *strings = (const char *)(pairs + header->pair_count);
+    // every offset is below strings_length and the last string is terminated, so all of them are.
+    if(strings[header->strings_length - 1] != '\0') {
+        return false;
+    }
+    const char *path = strings + header->strings_length;
+    if(path[header->path_length] != '\0' || strlen(path) != header->path_length) {
+        return false;
+    }
+    uint64_t pair_count = 0;
+    for(uint32_t i = 0; i < header->table_count; ++i) {
+        if(tables[i].name >= header->strings_length || (tables[i].flags & ~SNAPSHOT_DISTINCT_KEYS) || tables[i].reserved) {
+            return false;
+        }
+        pair_count += tables[i].pair_count;
+    }
+    if(pair_count != header->pair_count) {
+        return false;
+    }
+    for(uint32_t i = 0; i < header->pair_count; ++i) {
+        if(pairs[i].key >= header->strings_length) {
+            return false;
+        }
+        switch(pairs[i].type) {
+            case LIT_STRING:
+                if(pairs[i].value < 0 || (uint64_t)pairs[i].value >= header->strings_length) {
+                    return false;
+                }
+                break;
+            case LIT_BOOLEAN:
+                if(pairs[i].value != 0 && pairs[i].value != 1) {
+                    return false;
+                }
+                break;
+            case LIT_NUMBER:
+            case LIT_DATETIME:
+            case LIT_DURATION:
+            case LIT_SIZE:
+                break;
+            default:
+                return false;
+        }
+    }
+    return true;
+}
+
+// Build the tables of a valid snapshot.
+// The strings are copied to the arena so the snapshot can be unmapped.
+static void snapshot_build(const char *data, Array *tables, Arena *arena) {
+    const SnapshotHeader *header = (const SnapshotHeader *)data;
+    const SnapshotTable *snapshot_tables = (const SnapshotTable *)(data + sizeof(SnapshotHeader));
+    const SnapshotPair *snapshot_pairs = (const SnapshotPair *)(snapshot_tables + header->table_count);
+    char *strings = arenaAlloc(arena, header->strings_length);
+    memcpy(strings, snapshot_pairs + header->pair_count, header->strings_length);
+    Pair *pairs = arenaAlloc(arena, header->pair_count * sizeof(*pairs));
+
+    const SnapshotPair *next_pair = snapshot_pairs;
+    for(uint32_t i = 0; i < header->table_count; ++i) {
+        ConfigTable *t = arenaCalloc(arena, sizeof(*t));
+        t->name = strings + snapshot_tables[i].name;
+        t->distinct_keys = snapshot_tables[i].flags & SNAPSHOT_DISTINCT_KEYS;
+        arrayInitArenaCapacity(&t->pairs, arena, snapshot_tables[i].pair_count);
+        for(uint32_t j = 0; j < snapshot_tables[i].pair_count; ++j, ++next_pair) {
+            Pair *pair = pairs++;
+            pair->key = strings + next_pair->key;
+            LiteralType type = (LiteralType)next_pair->type;
+            if(type == LIT_STRING) {
+                pair->value = (Literal){.type = type, .as.string = strings + next_pair->value};
+            } else if(type == LIT_BOOLEAN) {
+                pair->value = (Literal){.type = type, .as.boolean = next_pair->value != 0};
+            } else {
+                pair->value = (Literal){.type = type, .as.number = next_pair->value};
+            }
+            arrayPush(&t->pairs, (void *)pair);
+        }
+        arrayPush(tables, (void *)t);
+    }
+}
+
+// The path of the file a valid snapshot was made from.
+static inline const char *snapshot_source(const char *data) {
+    const SnapshotHeader *header = (const SnapshotHeader *)data;
+    return data + header->size - header->path_length - 1;
+}
+
+// Whether a snapshot was made from the version of the file described by 'st'.
+// Only the header is read, so a snapshot of another version is skipped before it is checked.
+static bool snapshot_matches(const SnapshotHeader *header, const struct stat *st) {
+    return header->device == (uint64_t)st->st_dev && header->inode == (uint64_t)st->st_ino &&
+           header->content_length == (uint64_t)st->st_size &&
+           header->mtime_sec == (int64_t)st->st_mtim.tv_sec && header->mtime_nsec == (int64_t)st->st_mtim.tv_nsec;
+}
+
+bool snapshotLoad(const char *dir, const char *path, const struct stat *file, const char *contents, size_t length, Array *tables, Arena *arena) {
+    char absolute[PATH_MAX], name[SNAPSHOT_NAME_SIZE];
+    if(!absolute_path(absolute, path)) {
+        return false;
+    }
+    snapshot_name(name, absolute);
+    int dir_fd = snapshotOpenDir(dir);
+    if(dir_fd < 0) {
+        return false;
+    }
+    int fd = openat(dir_fd, name, O_RDONLY | O_CLOEXEC | O_NOFOLLOW);
+    close(dir_fd);
+    if(fd < 0) {
+        return false;
+    }
+    struct stat st;
+    if(fstat(fd, &st) < 0 || !S_ISREG(st.st_mode) || (size_t)st.st_size < sizeof(SnapshotHeader)) {
+        close(fd);
+        return false;
+    }
+    size_t size = (size_t)st.st_size;
+    void *data = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if(data == MAP_FAILED) {
+        return false;
+    }
+    const SnapshotHeader *header = data;
+    // the contents can change without changing the size and the mtime (within the resolution
+    // of the file system's timestamps, or when they are restored), hence the hash.
+    bool ok = memcmp(header->magic, SNAPSHOT_MAGIC, sizeof(header->magic)) == 0 &&
+              header->version == SNAPSHOT_VERSION && snapshot_matches(header, file) &&
+              header->content_length == length && snapshot_valid(data, size) &&
+              header->content_hash == hashBytes(contents, length, SNAPSHOT_CONTENT_SEED) &&
+              strcmp(snapshot_source(data), absolute) == 0;
+    if(ok) {
+        snapshot_build(data, tables, arena);
+    }
+    munmap(data, size);
+    return ok;
+}
+
+/* writing */
+
+static bool snapshot_write_all(int fd, const char *data, size_t size) {
+    while(size > 0) {
+        ssize_t n = write(fd, data, size);
+        if(n < 0) {
+            if(errno == EINTR) {
+                continue;
+            }
+            return false;
+        }
+        data += n;
+        size -= (size_t)n;
+    }
+    return true;
+}
+
+// Copy a string to the strings of a snapshot and return its offset.
+static uint32_t snapshot_string(char *strings, uint64_t *used, const char *s) {
+    size_t length = strlen(s) + 1;
+    uint32_t offset = (uint32_t)*used;
+    memcpy(strings + offset, s, length);
+    *used += length;
+    return offset;
+}
+
+void snapshotWrite(const char *dir, const char *path, const struct stat *file, const char *contents, size_t length, Array *tables) {
+    char absolute[PATH_MAX];
+    if(!absolute_path(absolute, path)) {
+        return;
+    }
+    size_t path_length = strlen(absolute);
+    uint64_t pair_count = 0, strings_length = 0;
+    for(size_t i = 0; i < tables->used; ++i) {
+        ConfigTable *t = ARRAY_GET_AS(ConfigTable *, tables, i);
+        strings_length += strlen(t->name) + 1;
+        for(size_t j = 0; j < t->pairs.used; ++j) {
+            Pair *pair = ARRAY_GET_AS(Pair *, &t->pairs, j);
+            strings_length += strlen(pair->key) + 1;
+            if(pair->value.type == LIT_STRING) {
+                strings_length += strlen(pair->value.as.string) + 1;
+            }
+        }
+        pair_count += t->pairs.used;
+    }
+    // the counts and the string offsets are 32-bit.
+    if(tables->used > UINT32_MAX || pair_count > UINT32_MAX || strings_length > UINT32_MAX) {
+        return;
+    }
+
+    size_t size = sizeof(SnapshotHeader) + tables->used * sizeof(SnapshotTable) + pair_count * sizeof(SnapshotPair) + strings_length + path_length + 1;
+    char *data = calloc(1, size);
+    if(!data) {
+        return;
+    }
+    SnapshotHeader *header = (SnapshotHeader *)data;
+    SnapshotTable *snapshot_tables = (SnapshotTable *)(data + sizeof(SnapshotHeader));
+    SnapshotPair *pairs = (SnapshotPair *)(snapshot_tables + tables->used);
+    char *strings = (char *)(pairs + pair_count);
+    uint64_t strings_used = 0;
+    for(size_t i = 0; i < tables->used; ++i) {
+        ConfigTable *t = ARRAY_GET_AS(ConfigTable *, tables, i);
+        snapshot_tables[i].name = snapshot_string(strings, &strings_used, t->name);
+        snapshot_tables[i].pair_count = (uint32_t)t->pairs.used;
+        snapshot_tables[i].flags = t->distinct_keys ? SNAPSHOT_DISTINCT_KEYS : 0;
+        for(size_t j = 0; j < t->pairs.used; ++j, ++pairs) {
+            Pair *pair = ARRAY_GET_AS(Pair *, &t->pairs, j);
+            pairs->key = snapshot_string(strings, &strings_used, pair->key);
+            pairs->type = (uint32_t)pair->value.type;
+            if(pair->value.type == LIT_STRING) {
+                pairs->value = snapshot_string(strings, &strings_used, pair->value.as.string);
+            } else if(pair->value.type == LIT_BOOLEAN) {
+                pairs->value = pair->value.as.boolean;
+            } else {
+                pairs->value = pair->value.as.number;
+            }
+        }
+    }
+    memcpy(strings + strings_length, absolute, path_length + 1);
+    memcpy(header->magic, SNAPSHOT_MAGIC, sizeof(header->magic));
+    header->version = SNAPSHOT_VERSION;
+    header->byte_order = SNAPSHOT_BYTE_ORDER;
+    header->path_length = path_length;
+    header->device = (uint64_t)file->st_dev;
+    header->inode = (uint64_t)file->st_ino;
+    header->content_length = length;
+    header->mtime_sec = (int64_t)file->st_mtim.tv_sec;
+    header->mtime_nsec = (int64_t)file->st_mtim.tv_nsec;
+    header->content_hash = hashBytes(contents, length, SNAPSHOT_CONTENT_SEED);
+    header->size = size;
+    header->table_count = (uint32_t)tables->used;
+    header->pair_count = (uint32_t)pair_count;
+    header->strings_length = strings_length;
+    header->checksum = hashBytes(data + sizeof(SnapshotHeader), size - sizeof(SnapshotHeader), SNAPSHOT_CHECKSUM_SEED);
+
+    char name[SNAPSHOT_NAME_SIZE], temp[64];
+    snapshot_name(name, absolute);
+    int dir_fd = snapshotOpenDir(dir);
+    if(dir_fd < 0) {
+        free(data);
+        return;
+    }
+    // the temporary file is unique to this process and call.
+    static unsigned counter = 0;
+    snprintf(temp, sizeof(temp), ".%.16s.%ld.%u.tmp", name, (long)getpid(), __atomic_fetch_add(&counter, 1, __ATOMIC_RELAXED));
+    int fd = openat(dir_fd, temp, O_WRONLY | O_CREAT | O_EXCL | O_CLOEXEC, 0600);
+    if(fd < 0) {
+        close(dir_fd);
+        free(data);
+        return;
+    }
+    bool ok = fchmod(fd, file->st_mode & 0666) == 0 && snapshot_write_all(fd, data, size);
+    ok = close(fd) == 0 && ok;
+    // readers see either the previous snapshot or the whole new one.
+    if(!ok || renameat(dir_fd, temp, dir_fd, name) < 0) {
+        unlinkat(dir_fd, temp, 0);
+    }
+    close(dir_fd);
+    free(data);
+}
+
+/* pruning */
+
+// A snapshot is stale if it is invalid (corrupt or of another version of the library),
+// isn't named after its file, or its file no longer exists.
+static bool snapshot_stale(int dir_fd, const char *name) {
+    int fd = openat(dir_fd, name, O_RDONLY | O_CLOEXEC | O_NOFOLLOW);
+    if(fd < 0) {
+        return false;
+    }
+    struct stat st;
+    if(fstat(fd, &st) < 0 || !S_ISREG(st.st_mode)) {
+        close(fd);
+        return false;
+    }
+    size_t size = (size_t)st.st_size;
+    void *data = size < sizeof(SnapshotHeader) ? MAP_FAILED : mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if(data == MAP_FAILED) {
+        return size < sizeof(SnapshotHeader);
+    }
+    bool stale = !snapshot_valid(data, size);
+    if(!stale) {
+        const char *source = snapshot_source(data);
+        char expected[SNAPSHOT_NAME_SIZE];
+        snapshot_name(expected, source);
+        stale = strcmp(name, expected) != 0 || (stat(source, &st) < 0 && (errno == ENOENT || errno == ENOTDIR));
+    }
+    munmap(data, size);
+    return stale;
+}
+
+bool snapshotPrune(const char *dir) {
+    int dir_fd = snapshotOpenDir(dir);
+    if(dir_fd < 0) {
+        return false;
+    }
+    // fdopendir() takes over its descriptor, the other one is used to open and remove the entries.
+    int list_fd = fcntl(dir_fd, F_DUPFD_CLOEXEC, 0);
+    DIR *d = list_fd < 0 ? NULL : fdopendir(list_fd);
+    if(!d) {
+        int saved_errno = errno;
+        if(list_fd >= 0) {
+            close(list_fd);
+        }
+        close(dir_fd);
+        errno = saved_errno;
+        return false;
+    }
+    time_t now = time(NULL);
+    struct dirent *entry;
+    while((entry = readdir(d))) {
+        const char *name = entry->d_name;
+        struct stat st;
+        if(name[0] == '.' && has_suffix(name, ".tmp")) {
+            if(fstatat(dir_fd, name, &st, AT_SYMLINK_NOFOLLOW) == 0 && S_ISREG(st.st_mode) && now - st.st_mtime > SNAPSHOT_TEMP_AGE) {
+                unlinkat(dir_fd, name, 0);
+            }
+        } else if(has_suffix(name, ".snapshot") && snapshot_stale(dir_fd, name)) {
+            unlinkat(dir_fd, name, 0);
+        }
+    }
+    closedir(d);
+    close(dir_fd);
+    return true;
+}
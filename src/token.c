@@ -3,12 +3,14 @@
 #include "token.h"
 
 
-Token tokenNew(TokenType type, int line, int at) {
+_Static_assert(sizeof(Token) == 16, "Token has to stay 16 bytes");
+
+Token tokenNew(TokenType type, uint32_t at) {
     Token tk = {
-        .type = type,
-        .line = line,
         .at = at,
-        .as = {.string_or_id = {0, 0}}
+        .type = (uint8_t)type,
+        .flags = 0,
+        .as = {.number = 0}
     };
     return tk;
 }
@@ -20,9 +22,12 @@ const char *tokenTypeString(TokenType type) {
         [TK_EQUAL]       = "=",
         [TK_NEWLINE]     = "<newline>",
         [TK_NUMBER]      = "<number>",
+        [TK_DATETIME]    = "<datetime>",
+        [TK_DURATION]    = "<duration>",
+        [TK_SIZE]        = "<size>",
         [TK_TRUE]        = "true",
         [TK_FALSE]       = "false",
-        [TK_STRING]      = "<stringr>",
+        [TK_STRING]      = "<string>",
         [TK_IDENTIFIER]  = "<identifier>",
         [TK_ERROR]       = "<error>",
         [TK_EOF]         = "<eof>"
@@ -0,0 +1,93 @@
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h> // memcpy
+#include "utf8.h"
+#include "unescape.h"
+
+#if defined(__SSE2__) && !defined(CONFIG_PARSER_NO_SIMD)
+#include <emmintrin.h>
+#define USE_SSE2
+#endif
+
+static uint32_t hex_value(const char *s, int digits) {
+    uint32_t value = 0;
+    for(int i = 0; i < digits; ++i) {
+        char c = s[i];
+        value <<= 4;
+        if(c >= '0' && c <= '9') {
+            value |= c - '0';
+        } else if(c >= 'a' && c <= 'f') {
+            value |= c - 'a' + 10;
+        } else {
+            value |= c - 'A' + 10;
+        }
+    }
+    return value;
+}
+
+static inline bool is_whitespace(char c) {
+    return c == ' ' || c == '\t' || c == '\r' || c == '\n';
+}
+
+// Decode the escape sequence starting at src[*i] (a backslash).
+// returns the number of bytes written to 'dest'.
+static size_t decode_escape(const char *src, size_t length, size_t *i, char *dest) {
+    char c = src[*i + 1];
+    *i += 2;
+    switch(c) {
+        case 'b': *dest = '\b'; return 1;
+        case 't': *dest = '\t'; return 1;
+        case 'n': *dest = '\n'; return 1;
+        case 'f': *dest = '\f'; return 1;
+        case 'r': *dest = '\r'; return 1;
+        case '"': *dest = '"'; return 1;
+        case '\\': *dest = '\\'; return 1;
+        case 'u':
+            *i += 4;
+            return utf8Encode(hex_value(src + *i - 4, 4), dest);
+        case 'U':
+            *i += 8;
+            return utf8Encode(hex_value(src + *i - 8, 8), dest);
+        default:
+            // line ending backslash: trim all whitespace up to the next non-whitespace character.
+            while(*i < length && is_whitespace(src[*i])) {
+                *i += 1;
+            }
+            return 0;
+    }
+}
+
+size_t unescapeString(const char *src, size_t length, char *dest) {
+    size_t i = 0, out = 0;
+    while(i < length) {
+#ifdef USE_SSE2
+        // copy 16 byte blocks that don't contain a backslash as-is.
+        const __m128i backslash = _mm_set1_epi8('\\');
+        while(i + 16 <= length) {
+            __m128i block = _mm_loadu_si128((const __m128i *)(src + i));
+            int special = _mm_movemask_epi8(_mm_cmpeq_epi8(block, backslash));
+            if(special) {
+                int n = __builtin_ctz(special);
+                memcpy(dest + out, src + i, n);
+                i += n;
+                out += n;
+                break;
+            }
+            _mm_storeu_si128((__m128i *)(dest + out), block);
+            i += 16;
+            out += 16;
+        }
+        if(i >= length) {
+            break;
+        }
+#endif
+        if(src[i] == '\\') {
+            out += decode_escape(src, length, &i, dest + out);
+        } else {
+            dest[out++] = src[i++];
+        }
+    }
+    dest[out] = '\0';
+    return out;
+}
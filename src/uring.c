@@ -0,0 +1,129 @@
+#include "uring.h"
+
+#ifdef HAVE_IO_URING
+
+#include <string.h> // memset
+#include <errno.h>
+#include <unistd.h> // syscall, close
+#include <sys/mman.h>
+#include <sys/syscall.h>
+
+static int uring_setup(unsigned entries, struct io_uring_params *params) {
+    return (int)syscall(__NR_io_uring_setup, entries, params);
+}
+
+static int uring_enter(int fd, unsigned to_submit, unsigned min_complete, unsigned flags) {
+    return (int)syscall(__NR_io_uring_enter, fd, to_submit, min_complete, flags, NULL, 0);
+}
+
+int uringInit(Uring *u, unsigned entries) {
+    struct io_uring_params params;
+    memset(&params, 0, sizeof(params));
+    memset(u, 0, sizeof(*u));
+    u->fd = uring_setup(entries, &params);
+    if(u->fd < 0) {
+        return -errno;
+    }
+
+    u->sq_ring_size = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    u->cq_ring_size = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+    // with IORING_FEAT_SINGLE_MMAP both rings share one mapping.
+    if(params.features & IORING_FEAT_SINGLE_MMAP) {
+        if(u->cq_ring_size > u->sq_ring_size) {
+            u->sq_ring_size = u->cq_ring_size;
+        }
+        u->cq_ring_size = u->sq_ring_size;
+    }
+    u->sq_ring = mmap(NULL, u->sq_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED, u->fd, IORING_OFF_SQ_RING);
+    if(u->sq_ring == MAP_FAILED) {
+        int error = errno;
+        close(u->fd);
+        return -error;
+    }
+    if(params.features & IORING_FEAT_SINGLE_MMAP) {
+        u->cq_ring = u->sq_ring;
+    } else {
+        u->cq_ring = mmap(NULL, u->cq_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED, u->fd, IORING_OFF_CQ_RING);
+        if(u->cq_ring == MAP_FAILED) {
+            int error = errno;
+            munmap(u->sq_ring, u->sq_ring_size);
+            close(u->fd);
+            return -error;
+        }
+    }
+    u->sqes_size = params.sq_entries * sizeof(struct io_uring_sqe);
+    u->sqes = mmap(NULL, u->sqes_size, PROT_READ | PROT_WRITE, MAP_SHARED, u->fd, IORING_OFF_SQES);
+    if(u->sqes == MAP_FAILED) {
+        int error = errno;
+        if(u->cq_ring != u->sq_ring) {
+            munmap(u->cq_ring, u->cq_ring_size);
+        }
+        munmap(u->sq_ring, u->sq_ring_size);
+        close(u->fd);
+        return -error;
+    }
+
+    char *sq = u->sq_ring, *cq = u->cq_ring;
+    u->sq_head = (unsigned *)(sq + params.sq_off.head);
+    u->sq_tail = (unsigned *)(sq + params.sq_off.tail);
+    u->sq_mask = (unsigned *)(sq + params.sq_off.ring_mask);
+    u->sq_array = (unsigned *)(sq + params.sq_off.array);
+    u->sq_entries = params.sq_entries;
+    u->cq_head = (unsigned *)(cq + params.cq_off.head);
+    u->cq_tail = (unsigned *)(cq + params.cq_off.tail);
+    u->cq_mask = (unsigned *)(cq + params.cq_off.ring_mask);
+    u->cqes = (struct io_uring_cqe *)(cq + params.cq_off.cqes);
+    return 0;
+}
+
+void uringFree(Uring *u) {
+    munmap(u->sqes, u->sqes_size);
+    if(u->cq_ring != u->sq_ring) {
+        munmap(u->cq_ring, u->cq_ring_size);
+    }
+    munmap(u->sq_ring, u->sq_ring_size);
+    close(u->fd);
+}
+
+struct io_uring_sqe *uringGetSqe(Uring *u) {
+    // the kernel moves the head as it consumes entries.
+    unsigned head = __atomic_load_n(u->sq_head, __ATOMIC_ACQUIRE);
+    unsigned tail = *u->sq_tail + u->to_submit;
+    if(tail - head >= u->sq_entries) {
+        return NULL;
+    }
+    unsigned index = tail & *u->sq_mask;
+    struct io_uring_sqe *sqe = &u->sqes[index];
+    memset(sqe, 0, sizeof(*sqe));
+    u->sq_array[index] = index;
+    u->to_submit++;
+    return sqe;
+}
+
+int uringSubmit(Uring *u, unsigned wait) {
+    // publish the new entries before entering the kernel.
+    unsigned tail = *u->sq_tail + u->to_submit;
+    __atomic_store_n(u->sq_tail, tail, __ATOMIC_RELEASE);
+    u->to_submit = 0;
+    // the entries a failed call didn't consume are submitted again.
+    unsigned to_submit = tail - __atomic_load_n(u->sq_head, __ATOMIC_ACQUIRE);
+    int result;
+    do {
+        result = uring_enter(u->fd, to_submit, wait, wait ? IORING_ENTER_GETEVENTS : 0);
+    } while(result < 0 && errno == EINTR);
+    return result < 0 ? -errno : result;
+}
+
+struct io_uring_cqe *uringPeek(Uring *u) {
+    unsigned head = *u->cq_head;
+    if(head == __atomic_load_n(u->cq_tail, __ATOMIC_ACQUIRE)) {
+        return NULL;
+    }
+    return &u->cqes[head & *u->cq_mask];
+}
+
+void uringSeen(Uring *u) {
+    __atomic_store_n(u->cq_head, *u->cq_head + 1, __ATOMIC_RELEASE);
+}
+
+#endif // HAVE_IO_URING
@@ -0,0 +1,97 @@
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include "utf8.h"
+
+#if defined(__SSE2__) && !defined(CONFIG_PARSER_NO_SIMD)
+#include <emmintrin.h>
+#define USE_SSE2
+#endif
+
+size_t utf8Encode(uint32_t codepoint, char *out) {
+    if(codepoint < 0x80) {
+        out[0] = (char)codepoint;
+        return 1;
+    } else if(codepoint < 0x800) {
+        out[0] = (char)(0xC0 | (codepoint >> 6));
+        out[1] = (char)(0x80 | (codepoint & 0x3F));
+        return 2;
+    } else if(codepoint < 0x10000) {
+        out[0] = (char)(0xE0 | (codepoint >> 12));
+        out[1] = (char)(0x80 | ((codepoint >> 6) & 0x3F));
+        out[2] = (char)(0x80 | (codepoint & 0x3F));
+        return 3;
+    }
+    out[0] = (char)(0xF0 | (codepoint >> 18));
+    out[1] = (char)(0x80 | ((codepoint >> 12) & 0x3F));
+    out[2] = (char)(0x80 | ((codepoint >> 6) & 0x3F));
+    out[3] = (char)(0x80 | (codepoint & 0x3F));
+    return 4;
+}
+
+static inline bool is_continuation(unsigned char c) {
+    return (c & 0xC0) == 0x80;
+}
+
+// See table 3-7 "Well-Formed UTF-8 Byte Sequences" in the unicode standard.
+size_t utf8SequenceLength(const unsigned char *s, size_t remaining) {
+    unsigned char c = s[0];
+    if(c < 0x80) {
+        return 1;
+    }
+    if(c >= 0xC2 && c <= 0xDF) {
+        return (remaining >= 2 && is_continuation(s[1])) ? 2 : 0;
+    }
+    if(c >= 0xE0 && c <= 0xEF) {
+        if(remaining < 3 || !is_continuation(s[1]) || !is_continuation(s[2])) {
+            return 0;
+        }
+        // reject overlong encodings and surrogates.
+        if((c == 0xE0 && s[1] < 0xA0) || (c == 0xED && s[1] > 0x9F)) {
+            return 0;
+        }
+        return 3;
+    }
+    if(c >= 0xF0 && c <= 0xF4) {
+        if(remaining < 4 || !is_continuation(s[1]) || !is_continuation(s[2]) || !is_continuation(s[3])) {
+            return 0;
+        }
+        // reject overlong encodings and values above 0x10FFFF.
+        if((c == 0xF0 && s[1] < 0x90) || (c == 0xF4 && s[1] > 0x8F)) {
+            return 0;
+        }
+        return 4;
+    }
+    return 0;
+}
+
+size_t utf8Validate(const char *s, size_t length) {
+    const unsigned char *bytes = (const unsigned char *)s;
+    size_t i = 0;
+    while(i < length) {
+#ifdef USE_SSE2
+        // a block is pure ASCII if none of its bytes has the high bit set.
+        while(i + 16 <= length) {
+            int mask = _mm_movemask_epi8(_mm_loadu_si128((const __m128i *)(bytes + i)));
+            if(mask) {
+                i += __builtin_ctz(mask);
+                break;
+            }
+            i += 16;
+        }
+        if(i >= length) {
+            break;
+        }
+#endif
+        if(bytes[i] < 0x80) {
+            i++;
+            continue;
+        }
+        size_t n = utf8SequenceLength(bytes + i, length - i);
+        if(n == 0) {
+            return i;
+        }
+        i += n;
+    }
+    return length;
+}
@@ -0,0 +1,5 @@
+// The implementation of the single header for test_single_header and test_single_header_cpp.
+// Built with -Wpedantic -Werror, so the amalgamated sources have to be standard C.
+
+#define CONFIG_PARSER_IMPLEMENTATION
+#include "config_parser.h"
@@ -0,0 +1,78 @@
+#ifndef TEST_H
+#define TEST_H
+
+// A minimal test harness: a failed CHECK() is reported and the test goes on,
+// so one run reports every failure. main() returns TEST_RESULT().
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <limits.h> // PATH_MAX
+#include <unistd.h> // mkdtemp, unlink, rmdir
+#include <dirent.h>
+
+static int test_failures = 0;
+
+#define CHECK(cond) do { \
+        if(!(cond)) { \
+            fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond); \
+            test_failures++; \
+        } \
+    } while(0)
+
+#define CHECK_STR(actual, expected) do { \
+        const char *actual_ = (actual), *expected_ = (expected); \
+        if(!actual_ || strcmp(actual_, expected_) != 0) { \
+            fprintf(stderr, "%s:%d: check failed: %s is \"%s\", expected \"%s\"\n", \
+                    __FILE__, __LINE__, #actual, actual_ ? actual_ : "(null)", expected_); \
+            test_failures++; \
+        } \
+    } while(0)
+
+#define TEST_RESULT() (test_failures ? EXIT_FAILURE : EXIT_SUCCESS)
+
+// Create a temporary directory, its path is stored in 'path' (at least 64 bytes).
+static inline bool testMakeDir(char *path) {
+    strcpy(path, "/tmp/config_test.XXXXXX");
+    return mkdtemp(path) != NULL;
+}
+
+// Store 'dir'/'name' in 'path' (PATH_MAX bytes), false if it doesn't fit.
+static inline bool testPath(char *path, const char *dir, const char *name) {
+    int length = snprintf(path, PATH_MAX, "%s/%s", dir, name);
+    return length >= 0 && length < PATH_MAX;
+}
+
+// Write 'contents' to 'dir'/'name' and store the path of the file in 'path' (PATH_MAX bytes).
+static inline bool testWriteFile(char *path, const char *dir, const char *name, const char *contents) {
+    if(!testPath(path, dir, name)) {
+        return false;
+    }
+    FILE *fp = fopen(path, "wb");
+    if(!fp) {
+        return false;
+    }
+    bool ok = fwrite(contents, 1, strlen(contents), fp) == strlen(contents);
+    return fclose(fp) == 0 && ok;
+}
+
+// Remove a directory created by testMakeDir() and everything in it.
+static inline void testRemoveDir(const char *dir) {
+    DIR *d = opendir(dir);
+    if(d) {
+        struct dirent *entry;
+        char path[PATH_MAX];
+        while((entry = readdir(d))) {
+            if(strcmp(entry->d_name, ".") && strcmp(entry->d_name, "..") && testPath(path, dir, entry->d_name)) {
+                if(unlink(path) < 0) {
+                    testRemoveDir(path);
+                }
+            }
+        }
+        closedir(d);
+    }
+    rmdir(dir);
+}
+
+#endif // TEST_H
@@ -0,0 +1,107 @@
+// Configurations parsed with config_parse_many(), with io_uring and with blocking I/O.
+
+#include <errno.h>
+#include <sys/stat.h> // mkdir
+#include "config_parser.h"
+#include "test.h"
+
+#define FILES 40
+
+static char dir[64];
+static char paths[FILES][PATH_MAX];
+static const char *path_list[FILES];
+
+// Every 7th file is invalid and every 11th file doesn't exist, the others set 'index' to their index.
+static int expected_error(size_t i) {
+    if(i % 11 == 5) {
+        return ENOENT;
+    }
+    return i % 7 == 3 ? EINVAL : 0;
+}
+
+static void write_files(void) {
+    for(size_t i = 0; i < FILES; ++i) {
+        char name[32], contents[64];
+        snprintf(name, sizeof(name), "%zu.toml", i);
+        snprintf(contents, sizeof(contents), expected_error(i) == EINVAL ? "index = \n" : "index = %zu\n\n[t]\nx = true\n", i);
+        if(expected_error(i) == ENOENT) {
+            CHECK(testPath(paths[i], dir, name));
+        } else {
+            CHECK(testWriteFile(paths[i], dir, name, contents));
+        }
+        path_list[i] = paths[i];
+    }
+}
+
+static void check_batch(ConfigParseOptions *opts) {
+    ConfigParser parsers[FILES];
+    int errors[FILES];
+    memset(errors, -1, sizeof(errors));
+    opts->errors = errors;
+    size_t expected_parsed = 0;
+    for(size_t i = 0; i < FILES; ++i) {
+        expected_parsed += expected_error(i) == 0;
+    }
+    CHECK(config_parse_many(path_list, FILES, parsers, opts) == expected_parsed);
+    for(size_t i = 0; i < FILES; ++i) {
+        int expected = expected_error(i);
+        if(expected == EINVAL) {
+            // the errno of a syntax error isn't specified, only that there is one.
+            CHECK(errors[i] != 0 && errors[i] != -1);
+        } else {
+            CHECK(errors[i] == expected);
+        }
+        if(errors[i] != 0) {
+            continue;
+        }
+        ConfigTable *top = config_get_table(&parsers[i], "__toplevel__");
+        CHECK(top && config_get_number_or(top, "index", -1) == (int64_t)i);
+        ConfigTable *t = config_get_table(&parsers[i], "t");
+        CHECK(t && config_get_boolean_or(t, "x", false));
+        config_end(&parsers[i]);
+    }
+}
+
+static void test_batches(void) {
+    int threads[] = {1, 2, 8, 0};
+    for(size_t i = 0; i < sizeof(threads) / sizeof(threads[0]); ++i) {
+        ConfigParseOptions opts = {.threads = threads[i]};
+        check_batch(&opts);
+        // a queue shorter than the batch.
+        opts = (ConfigParseOptions){.threads = threads[i], .queue_depth = 4};
+        check_batch(&opts);
+        opts = (ConfigParseOptions){.threads = threads[i], .no_io_uring = true};
+        check_batch(&opts);
+    }
+}
+
+static void test_cache_dir(void) {
+    char cache[PATH_MAX];
+    CHECK(testPath(cache, dir, "cache"));
+    CHECK(mkdir(cache, 0700) == 0);
+    // the second batch loads the snapshots of the first one.
+    for(int i = 0; i < 2; ++i) {
+        ConfigParseOptions opts = {.threads = 4, .cache_dir = cache};
+        check_batch(&opts);
+    }
+}
+
+static void test_empty_batch(void) {
+    // nothing is read from or written to the arrays.
+    CHECK(config_parse_many(NULL, 0, NULL, NULL) == 0);
+    ConfigParseOptions opts = {.no_io_uring = true};
+    CHECK(config_parse_many(NULL, 0, NULL, &opts) == 0);
+}
+
+int main(void) {
+    if(!testMakeDir(dir)) {
+        fprintf(stderr, "can't create the test directory\n");
+        return EXIT_FAILURE;
+    }
+    write_files();
+    test_batches();
+    test_cache_dir();
+    test_empty_batch();
+    testRemoveDir(dir);
+    return TEST_RESULT();
+}
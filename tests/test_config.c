@@ -0,0 +1,631 @@
+// Configurations loaded with config_parse(): includes, environment variables, iteration, reloading and freezing.
+
+#include <errno.h>
+#include <sys/stat.h> // mkdir
+#include "config_parser.h"
+#include "config_internal.h"
+#include "test.h"
+
+// Count the allocations by wrapping glibc's allocator, unless a sanitizer replaces it.
+#if defined(__GLIBC__) && !defined(__SANITIZE_ADDRESS__) && !defined(__SANITIZE_THREAD__)
+#define COUNT_ALLOCATIONS
+extern void *__libc_malloc(size_t size);
+extern void *__libc_calloc(size_t count, size_t size);
+extern void *__libc_realloc(void *ptr, size_t size);
+
+static size_t allocations = 0;
+
+void *malloc(size_t size) {
+    allocations++;
+    return __libc_malloc(size);
+}
+
+void *calloc(size_t count, size_t size) {
+    allocations++;
+    return __libc_calloc(count, size);
+}
+
+void *realloc(void *ptr, size_t size) {
+    allocations++;
+    return __libc_realloc(ptr, size);
+}
+#endif
+
+static char dir[64];
+
+// Write a file in the test directory, 'name' may be in a subdirectory.
+static void write_file(const char *name, const char *contents) {
+    char path[PATH_MAX];
+    CHECK(testWriteFile(path, dir, name, contents));
+}
+
+// Parse the file 'name' of the test directory, with includes and environment variables.
+static ConfigTable *parse(ConfigParser *p, const char *name) {
+    char path[PATH_MAX];
+    CHECK(testPath(path, dir, name));
+    ConfigParseOptions opts = {.includes = true, .expand_env = true};
+    return config_parse_with_options(p, path, &opts);
+}
+
+// Reparse the file 'name' of the test directory.
+static ConfigTable *reparse(ConfigParser *p, const char *name) {
+    char path[PATH_MAX];
+    CHECK(testPath(path, dir, name));
+    return config_reparse(p, path);
+}
+
+static void test_includes(void) {
+    ConfigParser p;
+    char sub[PATH_MAX];
+    CHECK(testPath(sub, dir, "sub"));
+    CHECK(mkdir(sub, 0700) == 0);
+    // include paths are relative to the directory of the including file.
+    write_file("sub/base.toml", "port = 80\nname = \"base\"\ninclude = \"extra.toml\"\n\n[db]\nhost = \"localhost\"\nuser = \"base\"\n");
+    write_file("sub/extra.toml", "extra = true\n");
+    write_file("main.toml", "include = \"sub/base.toml\"\nport = 8080\n\n[db]\nuser = \"main\"\n");
+
+    ConfigTable *top = parse(&p, "main.toml");
+    CHECK(top);
+    if(top) {
+        // later definitions of a key replace earlier ones, the other keys are kept.
+        CHECK(config_get_number_or(top, "port", 0) == 8080);
+        CHECK_STR(config_get_string_or(top, "name", NULL), "base");
+        CHECK(config_get_boolean_or(top, "extra", false));
+        // the include pairs aren't part of the configuration.
+        CHECK(config_get_type(top, "include") == CONFIG_TYPE_NONE);
+        ConfigTable *db = config_get_table(&p, "db");
+        CHECK(db);
+        if(db) {
+            CHECK_STR(config_get_string_or(db, "host", NULL), "localhost");
+            CHECK_STR(config_get_string_or(db, "user", NULL), "main");
+        }
+        CHECK(config_table_count(&p) == 2);
+        config_end(&p);
+    }
+
+    // the included file is merged at the point of the include.
+    write_file("override_first.toml", "port = 8080\ninclude = \"sub/base.toml\"\n");
+    top = parse(&p, "override_first.toml");
+    CHECK(top && config_get_number_or(top, "port", 0) == 80);
+    if(top) {
+        config_end(&p);
+    }
+
+    write_file("missing.toml", "include = \"does_not_exist.toml\"\n");
+    errno = 0;
+    CHECK(!parse(&p, "missing.toml") && errno == ENOENT);
+    write_file("not_a_string.toml", "include = 1\n");
+    errno = 0;
+    CHECK(!parse(&p, "not_a_string.toml") && errno == EINVAL);
+}
+
+static void test_include_cycles(void) {
+    ConfigParser p;
+    write_file("self.toml", "include = \"self.toml\"\n");
+    errno = 0;
+    CHECK(!parse(&p, "self.toml") && errno == ELOOP);
+
+    write_file("a.toml", "a = 1\ninclude = \"b.toml\"\n");
+    write_file("b.toml", "b = 1\ninclude = \"c.toml\"\n");
+    write_file("c.toml", "include = \"a.toml\"\n");
+    errno = 0;
+    CHECK(!parse(&p, "a.toml") && errno == ELOOP);
+
+    // including the same file twice isn't a cycle.
+    write_file("twice.toml", "include = \"c_leaf.toml\"\ninclude = \"c_leaf.toml\"\n");
+    write_file("c_leaf.toml", "leaf = 1\n");
+    ConfigTable *top = parse(&p, "twice.toml");
+    CHECK(top && config_get_number_or(top, "leaf", 0) == 1);
+    if(top) {
+        config_end(&p);
+    }
+}
+
+static void test_environment(void) {
+    ConfigParser p;
+    setenv("CONFIG_TEST_HOST", "example.org", 1);
+    unsetenv("CONFIG_TEST_PORT");
+    unsetenv("CONFIG_TEST_UNSET");
+    write_file("env.toml", "url = \"http://${CONFIG_TEST_HOST}:${CONFIG_TEST_PORT:-80}/\"\n"
+                           "empty_default = \"[${CONFIG_TEST_PORT:-}]\"\n"
+                           "literal = \"$${CONFIG_TEST_HOST}\"\n"
+                           "raw = '${CONFIG_TEST_HOST}'\n"
+                           "dollar = \"$5 and $ {x}\"\n");
+    ConfigTable *top = parse(&p, "env.toml");
+    CHECK(top);
+    if(top) {
+        CHECK_STR(config_get_string_or(top, "url", NULL), "http://example.org:80/");
+        CHECK_STR(config_get_string_or(top, "empty_default", NULL), "[]");
+        CHECK_STR(config_get_string_or(top, "literal", NULL), "${CONFIG_TEST_HOST}");
+        // literal strings are expanded as well, the expansion is done on the values.
+        CHECK_STR(config_get_string_or(top, "raw", NULL), "example.org");
+        CHECK_STR(config_get_string_or(top, "dollar", NULL), "$5 and $ {x}");
+        config_end(&p);
+    }
+
+    // a set variable wins over the default.
+    setenv("CONFIG_TEST_PORT", "8080", 1);
+    top = parse(&p, "env.toml");
+    CHECK(top && !strcmp(config_get_string_or(top, "url", ""), "http://example.org:8080/"));
+    if(top) {
+        config_end(&p);
+    }
+
+    write_file("unset.toml", "a = \"${CONFIG_TEST_UNSET}\"\n");
+    errno = 0;
+    CHECK(!parse(&p, "unset.toml") && errno == EINVAL);
+    write_file("unterminated.toml", "a = \"${CONFIG_TEST_HOST\"\n");
+    errno = 0;
+    CHECK(!parse(&p, "unterminated.toml") && errno == EINVAL);
+    // variables in included files are expanded too.
+    write_file("include_env.toml", "include = \"unset.toml\"\n");
+    CHECK(!parse(&p, "include_env.toml"));
+}
+
+// The number of pairs of a table.
+static size_t pair_count(ConfigTable *t) {
+    size_t count = 0;
+    ConfigIter it = config_table_iter(t);
+    while(config_iter_next(&it, NULL, NULL, NULL)) {
+        count++;
+    }
+    return count;
+}
+
+static void test_iteration(void) {
+    ConfigParser p;
+    write_file("iter.toml", "b = 1\na = \"two\"\nc = true\nd = 1s\n\n[empty]\n\n[t]\nz = 1\n");
+    ConfigTable *top = parse(&p, "iter.toml");
+    CHECK(top);
+    if(!top) {
+        return;
+    }
+    // the pairs in the order of the file, each exactly once, with their types and values.
+    const char *keys[] = {"b", "a", "c", "d"};
+    ConfigType types[] = {CONFIG_TYPE_NUMBER, CONFIG_TYPE_STRING, CONFIG_TYPE_BOOLEAN, CONFIG_TYPE_DURATION};
+    for(int frozen = 0; frozen < 2; ++frozen) {
+        ConfigIter it = config_table_iter(top);
+        const char *key;
+        ConfigType type;
+        ConfigValue value;
+        size_t count = 0;
+        while(config_iter_next(&it, &key, &type, &value)) {
+            CHECK(count < 4);
+            if(count < 4) {
+                CHECK_STR(key, keys[count]);
+                CHECK(type == types[count] && value.ok);
+            }
+            count++;
+        }
+        CHECK(count == 4);
+        // a finished cursor stays finished.
+        CHECK(!config_iter_next(&it, &key, &type, &value));
+        // freezing doesn't change the order.
+        CHECK(config_freeze(&p));
+    }
+    ConfigIter it = config_table_iter(top);
+    ConfigValue value;
+    CHECK(config_iter_next(&it, NULL, NULL, &value) && value.as.number == 1);
+    CHECK(config_iter_next(&it, NULL, NULL, &value) && !strcmp(value.as.string, "two"));
+
+    // an empty table.
+    ConfigTable *empty = config_get_table(&p, "empty");
+    CHECK(empty);
+    if(empty) {
+        it = config_table_iter(empty);
+        CHECK(!config_iter_next(&it, NULL, NULL, NULL));
+    }
+
+    // the tables in the order of the file, the top-level table first.
+    const char *names[] = {"__toplevel__", "empty", "t"};
+    it = config_tables_iter(&p);
+    ConfigTable *t;
+    const char *name;
+    size_t count = 0;
+    while(config_tables_next(&it, &t, &name)) {
+        CHECK(count < 3 && !strcmp(name, names[count]) && !strcmp(config_table_name(t), name));
+        count++;
+    }
+    CHECK(count == 3);
+    config_end(&p);
+
+    // every pair of a larger table, frozen, exactly once.
+    enum { KEYS = 1000 };
+    static char source[KEYS * 32];
+    size_t length = 0;
+    for(int i = 0; i < KEYS; ++i) {
+        length += snprintf(source + length, sizeof(source) - length, "key_%d = %d\n", i, i);
+    }
+    write_file("iter_large.toml", source);
+    top = parse(&p, "iter_large.toml");
+    CHECK(top && config_freeze(&p));
+    if(top) {
+        int seen[KEYS] = {0};
+        int previous = -1;
+        bool ordered = true;
+        it = config_table_iter(top);
+        while(config_iter_next(&it, NULL, NULL, &value)) {
+            CHECK(value.as.number >= 0 && value.as.number < KEYS);
+            if(value.as.number >= 0 && value.as.number < KEYS) {
+                seen[value.as.number]++;
+            }
+            ordered = ordered && value.as.number == previous + 1;
+            previous = (int)value.as.number;
+        }
+        CHECK(ordered);
+        for(int i = 0; i < KEYS; ++i) {
+            CHECK(seen[i] == 1);
+        }
+        config_end(&p);
+    }
+}
+
+static void test_merging(void) {
+    ConfigParser p;
+    // a file that doesn't need merging.
+    write_file("unique.toml", "a = 1\nb = 2\n\n[t]\nx = 1\n");
+    ConfigTable *top = parse(&p, "unique.toml");
+    CHECK(top);
+    if(top) {
+        CHECK(config_table_count(&p) == 2);
+        CHECK(pair_count(top) == 2 && config_get_number_or(top, "b", 0) == 2);
+        CHECK(config_freeze(&p));
+        CHECK(config_get_number_or(config_get_table(&p, "t"), "x", 0) == 1);
+        config_end(&p);
+    }
+
+    // a key defined twice, the later definition replaces the earlier one.
+    write_file("twice_key.toml", "a = 1\nb = 2\na = 3\n");
+    top = parse(&p, "twice_key.toml");
+    CHECK(top);
+    if(top) {
+        CHECK(pair_count(top) == 2 && config_get_number_or(top, "a", 0) == 3);
+        CHECK(config_freeze(&p));
+        CHECK(config_get_number_or(top, "a", 0) == 3);
+        config_end(&p);
+    }
+
+    // a table defined twice, including the top-level table.
+    write_file("twice_table.toml", "a = 1\n\n[t]\nx = 1\ny = 1\n\n[t]\ny = 2\n\n[__toplevel__]\nb = 2\n");
+    top = parse(&p, "twice_table.toml");
+    CHECK(top);
+    if(top) {
+        CHECK(config_table_count(&p) == 2);
+        CHECK(config_get_number_or(top, "b", 0) == 2);
+        ConfigTable *t = config_get_table(&p, "t");
+        CHECK(t && pair_count(t) == 2 && config_get_number_or(t, "y", 0) == 2);
+        config_end(&p);
+    }
+}
+
+static void test_without_options(void) {
+    ConfigParser p;
+    char path[PATH_MAX];
+    unsetenv("CONFIG_TEST_UNSET");
+    write_file("plain_inc.toml", "included = true\n");
+    write_file("plain.toml", "include = \"plain_inc.toml\"\nvalue = \"${CONFIG_TEST_UNSET}\"\n");
+    CHECK(testPath(path, dir, "plain.toml"));
+    // without the options 'include' is an ordinary key and strings are kept as they are.
+    ConfigTable *top = config_parse(&p, path);
+    CHECK(top);
+    if(top) {
+        CHECK_STR(config_get_string_or(top, "include", NULL), "plain_inc.toml");
+        CHECK_STR(config_get_string_or(top, "value", NULL), "${CONFIG_TEST_UNSET}");
+        CHECK(config_get_type(top, "included") == CONFIG_TYPE_NONE);
+        config_end(&p);
+    }
+    // each option can be used alone.
+    ConfigParseOptions opts = {.includes = true};
+    top = config_parse_with_options(&p, path, &opts);
+    CHECK(top && config_get_boolean_or(top, "included", false));
+    CHECK(top && !strcmp(config_get_string_or(top, "value", ""), "${CONFIG_TEST_UNSET}"));
+    if(top) {
+        config_end(&p);
+    }
+    opts = (ConfigParseOptions){.expand_env = true};
+    errno = 0;
+    CHECK(!config_parse_with_options(&p, path, &opts) && errno == EINVAL);
+    // the options are kept by config_reparse().
+    opts = (ConfigParseOptions){.includes = true};
+    top = config_parse_with_options(&p, path, &opts);
+    CHECK(top);
+    if(top) {
+        top = config_reparse(&p, path);
+        CHECK(top && config_get_boolean_or(top, "included", false));
+        config_end(&p);
+    }
+}
+
+// Whether every table of the configuration that has pairs is frozen.
+static bool all_frozen(ConfigParser *p) {
+    ConfigIter it = config_tables_iter(p);
+    ConfigTable *t;
+    while(config_tables_next(&it, &t, NULL)) {
+        if(t->pairs.used > 0 && !t->slots) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Write a file of 'count' pairs 'key_<i> = <i>' to the test directory.
+static void write_keys(const char *name, size_t count) {
+    size_t capacity = count * 32 + 1, length = 0;
+    char *source = malloc(capacity);
+    CHECK(source);
+    if(!source) {
+        return;
+    }
+    source[0] = '\0';
+    for(size_t i = 0; i < count; ++i) {
+        length += snprintf(source + length, capacity - length, "key_%zu = %zu\n", i, i);
+    }
+    write_file(name, source);
+    free(source);
+}
+
+static void test_freeze(void) {
+    ConfigParser p;
+    // a perfect hash maps keys that aren't in the table to some slot as well, so the key has to be compared.
+    const char *missing[] = {"", "key_", "key_100000", "key_1x", "KEY_1", "key_00", "ke", "key_99999 "};
+    enum { KEYS = 100000 };
+    write_keys("large.toml", KEYS);
+    ConfigTable *top = parse(&p, "large.toml");
+    CHECK(top && config_freeze(&p) && all_frozen(&p));
+    if(top) {
+        size_t found = 0;
+        for(size_t i = 0; i < KEYS; ++i) {
+            char key[32];
+            snprintf(key, sizeof(key), "key_%zu", i);
+            ConfigValue value = config_get_number(top, key);
+            found += value.ok && value.as.number == (int64_t)i;
+        }
+        CHECK(found == KEYS);
+        for(size_t i = 0; i < sizeof(missing) / sizeof(missing[0]); ++i) {
+            errno = 0;
+            CHECK(!config_get_number(top, missing[i]).ok && errno == EINVAL);
+            CHECK(config_get_type(top, missing[i]) == CONFIG_TYPE_NONE);
+        }
+        // every other missing key of the same shape.
+        size_t wrong = 0;
+        for(size_t i = KEYS; i < 2 * KEYS; ++i) {
+            char key[32];
+            snprintf(key, sizeof(key), "key_%zu", i);
+            wrong += config_get_type(top, key) != CONFIG_TYPE_NONE;
+        }
+        CHECK(wrong == 0);
+        config_end(&p);
+    }
+
+    // tables of one key, where every lookup lands on the same slot, and an empty table.
+    write_file("small.toml", "only = 1\n\n[t]\nx = \"x\"\n\n[empty]\n");
+    top = parse(&p, "small.toml");
+    CHECK(top && config_freeze(&p) && all_frozen(&p));
+    if(top) {
+        CHECK(config_get_number_or(top, "only", 0) == 1);
+        CHECK(config_get_type(top, "x") == CONFIG_TYPE_NONE);
+        CHECK(config_get_type(top, "onl") == CONFIG_TYPE_NONE);
+        ConfigTable *t = config_get_table(&p, "t");
+        CHECK(t && !config_get_string(t, "only").ok);
+        CHECK(t && config_get_type(t, "x") == CONFIG_TYPE_STRING);
+        ConfigTable *empty = config_get_table(&p, "empty");
+        CHECK(empty && config_get_type(empty, "x") == CONFIG_TYPE_NONE);
+        // freezing again does nothing.
+        CHECK(config_freeze(&p) && config_get_number_or(top, "only", 0) == 1);
+        config_end(&p);
+    }
+}
+
+// Look 'key' up in a chain and compare its number to 'expected', -1 if it should be missing.
+static bool chain_has(ConfigTable *chain, const char *key, int64_t expected) {
+    errno = 0;
+    ConfigValue value = config_get_number(chain, key);
+    if(expected < 0) {
+        return !value.ok && errno == EINVAL && config_get_type(chain, key) == CONFIG_TYPE_NONE;
+    }
+    return value.ok && value.as.number == expected;
+}
+
+static void test_chain(void) {
+    ConfigParser p;
+    write_file("chain.toml", "port = 0\n\n[host]\nport = 8080\nname = \"web\"\n\n[env]\nport = 80\ntimeout = 30\n\n"
+                             "[defaults]\nport = 1\ntimeout = 10\nretries = 3\n\n[empty]\n");
+    ConfigTable *top = parse(&p, "chain.toml");
+    CHECK(top);
+    if(!top) {
+        return;
+    }
+    ConfigTable *host = config_get_table(&p, "host"), *env = config_get_table(&p, "env"),
+                *defaults = config_get_table(&p, "defaults"), *empty = config_get_table(&p, "empty");
+    CHECK(host && env && defaults && empty);
+
+    for(int frozen = 0; frozen < 2; ++frozen) {
+        // a key is taken from the first table that has it.
+        ConfigTable *layers[] = {host, env, defaults};
+        ConfigTable *chain = config_chain(&p, layers, 3);
+        CHECK(chain && chain->slots);
+        if(chain) {
+            CHECK_STR(config_table_name(chain), "host");
+            CHECK(chain_has(chain, "port", 8080) && chain_has(chain, "timeout", 30) && chain_has(chain, "retries", 3));
+            CHECK_STR(config_get_string_or(chain, "name", NULL), "web");
+            CHECK(chain_has(chain, "user", -1) && config_get_number_or(chain, "user", 7) == 7);
+            // every key once, in the order of the layers.
+            const char *keys[] = {"port", "name", "timeout", "retries"};
+            ConfigIter it = config_table_iter(chain);
+            const char *key;
+            size_t count = 0;
+            while(config_iter_next(&it, &key, NULL, NULL)) {
+                CHECK(count < 4 && !strcmp(key, keys[count]));
+                count++;
+            }
+            CHECK(count == 4);
+        }
+        ConfigTable *reversed[] = {defaults, env, host};
+        chain = config_chain(&p, reversed, 3);
+        CHECK(chain && chain_has(chain, "port", 1) && chain_has(chain, "timeout", 10));
+        CHECK(chain && !strcmp(config_get_string_or(chain, "name", ""), "web"));
+        // empty and repeated layers.
+        ConfigTable *repeated[] = {empty, env, env, empty};
+        chain = config_chain(&p, repeated, 4);
+        CHECK(chain && !strcmp(config_table_name(chain), "empty"));
+        CHECK(chain && chain_has(chain, "port", 80) && chain_has(chain, "retries", -1));
+        ConfigTable *only_empty[] = {empty};
+        chain = config_chain(&p, only_empty, 1);
+        CHECK(chain && chain_has(chain, "port", -1));
+        errno = 0;
+        CHECK(!config_chain(&p, layers, 0) && errno == EINVAL);
+        // the layers aren't changed by the chains.
+        CHECK(chain_has(env, "port", 80) && chain_has(env, "retries", -1));
+        CHECK(frozen || !all_frozen(&p));
+        CHECK(config_freeze(&p));
+    }
+
+    // a failed reload keeps the configuration and its chains.
+    ConfigTable *layers[] = {host, defaults};
+    ConfigTable *chain = config_chain(&p, layers, 2);
+    write_file("chain.toml", "port = \n");
+    CHECK(!config_reload(&p));
+    CHECK(chain && chain_has(chain, "port", 8080) && chain_has(chain, "timeout", 10));
+    // a reload drops the chains, they are built again from the new tables.
+    write_file("chain.toml", "[host]\nname = \"web\"\n\n[defaults]\nport = 2\ntimeout = 20\n");
+    top = config_reload(&p);
+    CHECK(top && p.pool->chains.used == 0);
+    layers[0] = config_get_table(&p, "host");
+    layers[1] = config_get_table(&p, "defaults");
+    chain = layers[0] && layers[1] ? config_chain(&p, layers, 2) : NULL;
+    CHECK(chain && chain_has(chain, "port", 2) && chain_has(chain, "timeout", 20) && chain_has(chain, "retries", -1));
+    CHECK(p.pool->chains.used == 1);
+    // as does reparsing, and the parser's memory is freed with its chains by config_end().
+    CHECK(reparse(&p, "chain.toml") && p.pool->chains.used == 0);
+    errno = 0;
+    CHECK(!config_get_table(&p, "env") && errno == EINVAL);
+    config_end(&p);
+}
+
+// A parser without tables, after config_reset() or a failed config_reparse().
+static void check_no_tables(ConfigParser *p) {
+    CHECK(config_table_count(p) == 0);
+    errno = 0;
+    CHECK(!config_get_table(p, "") && errno == EINVAL);
+    ConfigIter it = config_tables_iter(p);
+    CHECK(!config_tables_next(&it, NULL, NULL));
+    errno = 0;
+    CHECK(!config_freeze(p) && errno == EINVAL);
+    ConfigTable *tables[] = {NULL};
+    errno = 0;
+    CHECK(!config_chain(p, tables, 1) && errno == EINVAL);
+}
+
+static void test_reuse(void) {
+    ConfigParser p;
+    write_file("reuse_a.toml", "name = \"a\"\nport = 1\n\n[db]\nhost = \"a\"\n\n[cache]\nsize = 16\n");
+    write_file("reuse_b.toml", "name = \"b\"\n\n[db]\nhost = \"b\"\n");
+    ConfigTable *top = parse(&p, "reuse_a.toml");
+    CHECK(top);
+    if(!top) {
+        return;
+    }
+
+    config_reset(&p);
+    check_no_tables(&p);
+    top = reparse(&p, "reuse_b.toml");
+    CHECK(top && config_table_count(&p) == 2);
+    CHECK_STR(top ? config_get_string_or(top, "name", NULL) : NULL, "b");
+    ConfigTable *db = config_get_table(&p, "db");
+    CHECK_STR(db ? config_get_string_or(db, "host", NULL) : NULL, "b");
+
+    // the parser keeps its memory on failure but has no tables.
+    errno = 0;
+    CHECK(!reparse(&p, "missing.toml") && errno == ENOENT);
+    check_no_tables(&p);
+    write_file("reuse_invalid.toml", "name = \n");
+    errno = 0;
+    CHECK(!reparse(&p, "reuse_invalid.toml") && errno == EINVAL);
+    check_no_tables(&p);
+    top = reparse(&p, "reuse_a.toml");
+    CHECK(top && config_table_count(&p) == 3);
+    CHECK(top && config_get_number_or(top, "port", 0) == 1);
+    config_reset(&p);
+    config_reset(&p);
+    check_no_tables(&p);
+
+#ifdef COUNT_ALLOCATIONS
+    // once both table arenas have held the larger configuration, reparsing allocates nothing.
+    for(int i = 0; i < 2; ++i) {
+        CHECK(reparse(&p, "reuse_a.toml"));
+    }
+    const char *names[] = {"reuse_a.toml", "reuse_b.toml", "reuse_a.toml"};
+    for(size_t i = 0; i < sizeof(names) / sizeof(names[0]); ++i) {
+        char path[PATH_MAX];
+        CHECK(testPath(path, dir, names[i]));
+        size_t before = allocations;
+        top = config_reparse(&p, path);
+        CHECK(allocations == before);
+        CHECK(top && config_get_type(top, "name") == CONFIG_TYPE_STRING);
+    }
+#endif
+    config_end(&p);
+}
+
+static void test_reload(void) {
+    ConfigParser p;
+    write_file("reload.toml", "a = 1\ninclude = \"reload_inc.toml\"\n\n[t]\nc = 3\n");
+    write_file("reload_inc.toml", "b = 2\n");
+    ConfigTable *top = parse(&p, "reload.toml");
+    CHECK(top);
+    if(!top) {
+        return;
+    }
+    CHECK(!all_frozen(&p));
+    CHECK(config_freeze(&p));
+    CHECK(all_frozen(&p));
+
+    // only the included file changed.
+    write_file("reload_inc.toml", "b = 20\nnew_key = true\n");
+    top = config_reload(&p);
+    CHECK(top);
+    if(top) {
+        CHECK(config_get_number_or(top, "a", 0) == 1);
+        CHECK(config_get_number_or(top, "b", 0) == 20);
+        CHECK(config_get_boolean_or(top, "new_key", false));
+        CHECK(config_get_number_or(config_get_table(&p, "t"), "c", 0) == 3);
+        // a frozen configuration is frozen again.
+        CHECK(all_frozen(&p));
+    }
+
+    // on failure the previous configuration is kept, still frozen.
+    write_file("reload.toml", "a = \n");
+    errno = 0;
+    CHECK(!config_reload(&p) && errno == EINVAL);
+    top = config_get_table(&p, "__toplevel__");
+    CHECK(top && config_get_number_or(top, "b", 0) == 20);
+    CHECK(config_get_number_or(config_get_table(&p, "t"), "c", 0) == 3);
+    CHECK(all_frozen(&p));
+
+    write_file("reload.toml", "a = 5\n\n[t]\nc = 6\n");
+    top = config_reload(&p);
+    CHECK(top && config_get_number_or(top, "a", 0) == 5);
+    CHECK(top && config_get_type(top, "b") == CONFIG_TYPE_NONE);
+    CHECK(config_get_number_or(config_get_table(&p, "t"), "c", 0) == 6);
+    CHECK(all_frozen(&p));
+    config_end(&p);
+}
+
+int main(void) {
+    if(!testMakeDir(dir)) {
+        perror("mkdtemp");
+        return EXIT_FAILURE;
+    }
+    test_includes();
+    test_include_cycles();
+    test_environment();
+    test_without_options();
+    test_merging();
+    test_iteration();
+    test_reload();
+    test_reuse();
+    test_chain();
+    test_freeze();
+    testRemoveDir(dir);
+    return TEST_RESULT();
+}
@@ -0,0 +1,78 @@
+// The string to index map used to merge tables.
+
+#include <stdint.h>
+#include "map.h"
+#include "test.h"
+
+#define KEYS 4096
+
+static char keys[KEYS][16];
+
+static void fill(Map *m, size_t count) {
+    for(size_t i = 0; i < count; ++i) {
+        mapSet(m, keys[i], i);
+    }
+}
+
+static bool holds(Map *m, size_t count) {
+    size_t value;
+    for(size_t i = 0; i < count; ++i) {
+        if(!mapGet(m, keys[i], &value) || value != i) {
+            return false;
+        }
+    }
+    return count == KEYS || !mapGet(m, keys[count], &value);
+}
+
+static void test_set_get(void) {
+    Map m;
+    mapInit(&m);
+    fill(&m, KEYS);
+    CHECK(m.used == KEYS);
+    CHECK(holds(&m, KEYS));
+    // setting a key again replaces its value.
+    mapSet(&m, keys[0], 42);
+    size_t value;
+    CHECK(mapGet(&m, keys[0], &value) && value == 42);
+    CHECK(m.used == KEYS);
+    mapFree(&m);
+}
+
+static void test_clear(void) {
+    Map m;
+    mapInit(&m);
+    fill(&m, KEYS);
+    size_t capacity = m.capacity;
+    MapEntry *entries = m.entries;
+
+    // refilling a map with as many keys reuses its memory.
+    mapClear(&m, 0);
+    CHECK(m.used == 0 && !holds(&m, 1));
+    CHECK(m.entries == entries && m.capacity == capacity);
+    fill(&m, KEYS);
+    CHECK(holds(&m, KEYS));
+
+    // a map much larger than its contents is shrunk, so clearing it doesn't touch all of it.
+    mapClear(&m, 0);
+    fill(&m, 10);
+    mapClear(&m, 10);
+    CHECK(m.capacity <= 32);
+    fill(&m, 10);
+    CHECK(holds(&m, 10));
+
+    // and it grows for the expected keys.
+    mapClear(&m, KEYS);
+    CHECK(m.capacity >= KEYS * 2);
+    fill(&m, KEYS);
+    CHECK(holds(&m, KEYS));
+    mapFree(&m);
+}
+
+int main(void) {
+    for(size_t i = 0; i < KEYS; ++i) {
+        snprintf(keys[i], sizeof(keys[i]), "key%zu", i);
+    }
+    test_set_get();
+    test_clear();
+    return TEST_RESULT();
+}
@@ -0,0 +1,214 @@
+// Tables parsed by config_parser_parse().
+
+#include <stdint.h>
+#include "array.h"
+#include "arena.h"
+#include "parser.h"
+#include "config_internal.h"
+#include "test.h"
+
+typedef struct parsed {
+    char source[512];
+    Arena arena;
+    Array tables; // Array<ConfigTable *>
+    bool ok;
+} Parsed;
+
+static void parse(Parsed *out, const char *source) {
+    snprintf(out->source, sizeof(out->source), "%s", source);
+    arenaInit(&out->arena);
+    arrayInitArena(&out->tables, &out->arena);
+    out->ok = config_parser_parse(out->source, &out->tables, &out->arena);
+}
+
+static void parsed_free(Parsed *pr) {
+    arenaFree(&pr->arena);
+}
+
+static ConfigTable *table(Parsed *pr, const char *name) {
+    for(size_t i = 0; i < pr->tables.used; ++i) {
+        ConfigTable *t = ARRAY_GET_AS(ConfigTable *, &pr->tables, i);
+        if(!strcmp(t->name, name)) {
+            return t;
+        }
+    }
+    return NULL;
+}
+
+static Literal *value(Parsed *pr, const char *table_name, const char *key) {
+    ConfigTable *t = table(pr, table_name);
+    for(size_t i = 0; t && i < t->pairs.used; ++i) {
+        Pair *pair = ARRAY_GET_AS(Pair *, &t->pairs, i);
+        if(!strcmp(pair->key, key)) {
+            return &pair->value;
+        }
+    }
+    return NULL;
+}
+
+static const char *string(Parsed *pr, const char *table_name, const char *key) {
+    Literal *v = value(pr, table_name, key);
+    return v && v->type == LIT_STRING ? v->as.string : NULL;
+}
+
+static bool number(Parsed *pr, const char *table_name, const char *key, LiteralType type, int64_t expected) {
+    Literal *v = value(pr, table_name, key);
+    return v && v->type == type && v->as.number == expected;
+}
+
+#define TOP "__toplevel__"
+
+static void test_tables(void) {
+    Parsed pr;
+    parse(&pr, "a = 1\n\n[one]\nb = true\nc = false\n\n[two]\nd = 'x'\n");
+    CHECK(pr.ok);
+    CHECK(pr.tables.used == 3);
+    CHECK_STR(ARRAY_GET_AS(ConfigTable *, &pr.tables, 0)->name, TOP);
+    CHECK(number(&pr, TOP, "a", LIT_NUMBER, 1));
+    CHECK(value(&pr, "one", "b") && value(&pr, "one", "b")->as.boolean);
+    CHECK(value(&pr, "one", "c") && !value(&pr, "one", "c")->as.boolean);
+    CHECK_STR(string(&pr, "two", "d"), "x");
+    parsed_free(&pr);
+
+    // the last line doesn't need a newline.
+    parse(&pr, "[t]\na = 1");
+    CHECK(pr.ok && number(&pr, "t", "a", LIT_NUMBER, 1));
+    parsed_free(&pr);
+
+    // an empty line ends a table, even right after its header.
+    parse(&pr, "[t]\n\na = 1\n\n\n[u]\nb = 2\n\nc = 3\n");
+    CHECK(pr.ok);
+    CHECK(table(&pr, "t") && table(&pr, "t")->pairs.used == 0);
+    CHECK(number(&pr, TOP, "a", LIT_NUMBER, 1));
+    CHECK(number(&pr, "u", "b", LIT_NUMBER, 2));
+    CHECK(number(&pr, TOP, "c", LIT_NUMBER, 3));
+    parsed_free(&pr);
+    // so a header can't follow the pairs of a table.
+    parse(&pr, "[t]\na = 1\n[u]\nb = 2\n");
+    CHECK(!pr.ok);
+    parsed_free(&pr);
+
+    parse(&pr, "[t\na = 1\n");
+    CHECK(!pr.ok);
+    parsed_free(&pr);
+    parse(&pr, "= 1\n");
+    CHECK(!pr.ok);
+    parsed_free(&pr);
+    parse(&pr, "a = 1 2\n");
+    CHECK(!pr.ok);
+    parsed_free(&pr);
+}
+
+static void test_strings(void) {
+    Parsed pr;
+    parse(&pr, "basic = \"tab:\\t quote:\\\" e:\\u00e9 smile:\\U0001F600 \\\\\"\n"
+               "literal = 'C:\\no\\escapes'\n"
+               "multi = \"\"\"\nfirst\nsecond \\\n    continued\"\"\"\n"
+               "raw = '''\nkeep \\n this\n'''\n"
+               "empty = \"\"\n");
+    CHECK(pr.ok);
+    CHECK_STR(string(&pr, TOP, "basic"), "tab:\t quote:\" e:\xc3\xa9 smile:\xf0\x9f\x98\x80 \\");
+    CHECK_STR(string(&pr, TOP, "literal"), "C:\\no\\escapes");
+    CHECK_STR(string(&pr, TOP, "multi"), "first\nsecond continued");
+    CHECK_STR(string(&pr, TOP, "raw"), "keep \\n this\n");
+    CHECK_STR(string(&pr, TOP, "empty"), "");
+    parsed_free(&pr);
+
+    parse(&pr, "a = \"unterminated\n");
+    CHECK(!pr.ok);
+    parsed_free(&pr);
+    parse(&pr, "a = \"bad \\q escape\"\n");
+    CHECK(!pr.ok);
+    parsed_free(&pr);
+    parse(&pr, "a = \"nul \\u0000 truncates\"\n");
+    CHECK(!pr.ok);
+    parsed_free(&pr);
+}
+
+static void test_comments(void) {
+    Parsed pr;
+    parse(&pr, "# a comment\n[t]\n# a comment line in the table\na = 1\n");
+    CHECK(pr.ok);
+    CHECK(number(&pr, "t", "a", LIT_NUMBER, 1));
+    parsed_free(&pr);
+
+    // a comment at the end of a line doesn't swallow the newline.
+    parse(&pr, "a = 1 # c\nb = 2");
+    CHECK(pr.ok);
+    CHECK(number(&pr, TOP, "a", LIT_NUMBER, 1));
+    CHECK(number(&pr, TOP, "b", LIT_NUMBER, 2));
+    parsed_free(&pr);
+
+    parse(&pr, "[t] # after a header\na = 1 # c\n  # a comment line\nb = 2 # c\n\nc = 3\n");
+    CHECK(pr.ok);
+    CHECK(number(&pr, "t", "a", LIT_NUMBER, 1));
+    CHECK(number(&pr, "t", "b", LIT_NUMBER, 2));
+    // the empty line ends the table.
+    CHECK(number(&pr, TOP, "c", LIT_NUMBER, 3));
+    parsed_free(&pr);
+
+    parse(&pr, "a = \"# not a comment\" # a comment");
+    CHECK(pr.ok);
+    CHECK_STR(string(&pr, TOP, "a"), "# not a comment");
+    parsed_free(&pr);
+}
+
+static void test_quoted_keys(void) {
+    Parsed pr;
+    parse(&pr, "\"clé\" = \"valeur\"\n\n[\"Zürich\"]\n'key with spaces' = 1\n\"escaped\\tkey\" = 2\n");
+    CHECK(pr.ok);
+    CHECK_STR(string(&pr, TOP, "clé"), "valeur");
+    CHECK(number(&pr, "Zürich", "key with spaces", LIT_NUMBER, 1));
+    CHECK(number(&pr, "Zürich", "escaped\tkey", LIT_NUMBER, 2));
+    parsed_free(&pr);
+
+    parse(&pr, "clé = 1\n");
+    CHECK(!pr.ok);
+    parsed_free(&pr);
+    // the whole source has to be valid UTF-8.
+    parse(&pr, "a = \"\xff\"\n");
+    CHECK(!pr.ok);
+    parsed_free(&pr);
+}
+
+static void test_literals(void) {
+    Parsed pr;
+    parse(&pr, "released = 1979-05-27T07:32:00-08:00\n"
+               "day = 2024-02-29\n"
+               "timeout = 1m30s\n"
+               "retry = 250ms\n"
+               "max_body = 16MiB\n"
+               "disk = 2TB\n"
+               "count = 1234567\n");
+    CHECK(pr.ok);
+    CHECK(number(&pr, TOP, "released", LIT_DATETIME, 296667120LL * 1000000000));
+    CHECK(number(&pr, TOP, "day", LIT_DATETIME, 19782LL * 86400 * 1000000000));
+    CHECK(number(&pr, TOP, "timeout", LIT_DURATION, 90LL * 1000000000));
+    CHECK(number(&pr, TOP, "retry", LIT_DURATION, 250LL * 1000000));
+    CHECK(number(&pr, TOP, "max_body", LIT_SIZE, 16LL << 20));
+    CHECK(number(&pr, TOP, "disk", LIT_SIZE, 2000000000000LL));
+    CHECK(number(&pr, TOP, "count", LIT_NUMBER, 1234567));
+    parsed_free(&pr);
+
+    parse(&pr, "thousand = 1_000\nalarm = 07:32:00\n");
+    CHECK(pr.ok);
+    CHECK(number(&pr, TOP, "thousand", LIT_NUMBER, 1000));
+    CHECK(number(&pr, TOP, "alarm", LIT_DATETIME, (7 * 3600 + 32 * 60) * 1000000000LL));
+    parsed_free(&pr);
+
+    parse(&pr, "a = 9999999999TiB\n");
+    CHECK(!pr.ok);
+    parsed_free(&pr);
+    parse(&pr, "a = 1KiB2MiB\n");
+    CHECK(!pr.ok);
+    parsed_free(&pr);
+}
+
+int main(void) {
+    test_tables();
+    test_strings();
+    test_comments();
+    test_quoted_keys();
+    test_literals();
+    return TEST_RESULT();
+}
@@ -0,0 +1,326 @@
+// Token streams of the scanner.
+
+#include <stdint.h>
+#include "scanner.h"
+#include "token.h"
+#include "test.h"
+
+#define MAX_TOKENS 64
+
+typedef struct scanned {
+    char source[256];
+    Token tokens[MAX_TOKENS];
+    size_t count;
+    bool had_error;
+} Scanned;
+
+// Scan 'source' until the end with scannerNextToken().
+static void scan(Scanned *out, const char *source) {
+    Scanner s;
+    snprintf(out->source, sizeof(out->source), "%s", source);
+    scannerInit(&s, out->source);
+    out->count = 0;
+    Token tk;
+    do {
+        tk = scannerNextToken(&s);
+        if(out->count < MAX_TOKENS) {
+            out->tokens[out->count++] = tk;
+        }
+    } while(tk.type != TK_EOF);
+    out->had_error = s.had_error;
+    scannerFree(&s);
+}
+
+// Check the types of the tokens, 'types' ends with TK_EOF.
+static bool types_are(const Scanned *sc, const TokenType *types) {
+    for(size_t i = 0; i < sc->count; ++i) {
+        if(sc->tokens[i].type != types[i]) {
+            fprintf(stderr, "token %zu is '%s', expected '%s'\n", i, tokenTypeString(sc->tokens[i].type), tokenTypeString(types[i]));
+            return false;
+        }
+        if(types[i] == TK_EOF) {
+            return i + 1 == sc->count;
+        }
+    }
+    return false;
+}
+
+// Scan 'source' and store what the scanner reported in 'errors'.
+// returns the number of bytes that were reported.
+static size_t scan_errors(Scanned *out, const char *source, char *errors, size_t size) {
+    fflush(stderr);
+    FILE *capture = tmpfile();
+    int saved = dup(fileno(stderr));
+    dup2(fileno(capture), fileno(stderr));
+    scan(out, source);
+    fflush(stderr);
+    dup2(saved, fileno(stderr));
+    close(saved);
+    rewind(capture);
+    size_t n = fread(errors, 1, size - 1, capture);
+    errors[n] = '\0';
+    fclose(capture);
+    return n;
+}
+
+static size_t count_lines(const char *s) {
+    size_t count = 0;
+    for(; *s; ++s) {
+        count += *s == '\n';
+    }
+    return count;
+}
+
+static bool text_is(const Scanned *sc, size_t i, const char *text) {
+    const Token *tk = &sc->tokens[i];
+    return tk->as.slice.length == strlen(text) && memcmp(sc->source + tk->as.slice.start, text, tk->as.slice.length) == 0;
+}
+
+static void test_pairs_and_tables(void) {
+    Scanned sc;
+    scan(&sc, "[table]\nkey = 42\nflag = true\n");
+    CHECK(types_are(&sc, (TokenType[]){TK_LBRACKET, TK_IDENTIFIER, TK_RBRACKET, TK_NEWLINE,
+                                       TK_IDENTIFIER, TK_EQUAL, TK_NUMBER, TK_NEWLINE,
+                                       TK_IDENTIFIER, TK_EQUAL, TK_TRUE, TK_NEWLINE, TK_EOF}));
+    CHECK(text_is(&sc, 1, "table"));
+    CHECK(text_is(&sc, 4, "key"));
+    CHECK(sc.tokens[6].as.number == 42);
+    CHECK(sc.tokens[4].at == 8);
+    CHECK(!sc.had_error);
+}
+
+static void test_strings(void) {
+    Scanned sc;
+    scan(&sc, "a = \"plain\"\nb = \"tab\\there\"\nc = 'C:\\raw'\n");
+    CHECK(types_are(&sc, (TokenType[]){TK_IDENTIFIER, TK_EQUAL, TK_STRING, TK_NEWLINE,
+                                       TK_IDENTIFIER, TK_EQUAL, TK_STRING, TK_NEWLINE,
+                                       TK_IDENTIFIER, TK_EQUAL, TK_STRING, TK_NEWLINE, TK_EOF}));
+    CHECK(text_is(&sc, 2, "plain"));
+    CHECK(!(sc.tokens[2].flags & TOKEN_HAS_ESCAPES));
+    CHECK(text_is(&sc, 6, "tab\\there"));
+    CHECK(sc.tokens[6].flags & TOKEN_HAS_ESCAPES);
+    // literal strings have no escapes.
+    CHECK(text_is(&sc, 10, "C:\\raw"));
+    CHECK(!(sc.tokens[10].flags & TOKEN_HAS_ESCAPES));
+
+    // the newline after the opening delimiter is trimmed, up to 2 quotes end the contents.
+    scan(&sc, "m = \"\"\"\nline 1\nline \"2\"\"\"\"\"\nl = '''\n'x' '''\n");
+    CHECK(types_are(&sc, (TokenType[]){TK_IDENTIFIER, TK_EQUAL, TK_STRING, TK_NEWLINE,
+                                       TK_IDENTIFIER, TK_EQUAL, TK_STRING, TK_NEWLINE, TK_EOF}));
+    CHECK(text_is(&sc, 2, "line 1\nline \"2\"\""));
+    CHECK(text_is(&sc, 6, "'x' "));
+
+    scan(&sc, "a = \"unterminated\n");
+    CHECK(sc.had_error);
+    scan(&sc, "a = \"\"\"\"\"\"\"\"\"\n");
+    CHECK(sc.had_error);
+}
+
+static void test_escapes(void) {
+    Scanned sc;
+    scan(&sc, "a = \"\\b\\t\\n\\f\\r\\\"\\\\ \\u00e9 \\U0001F600\"\n");
+    CHECK(types_are(&sc, (TokenType[]){TK_IDENTIFIER, TK_EQUAL, TK_STRING, TK_NEWLINE, TK_EOF}));
+    CHECK(!sc.had_error);
+
+    const char *invalid[] = {
+        "a = \"\\x\"\n",
+        "a = \"\\u12\"\n",
+        "a = \"\\uD800\"\n",
+        "a = \"\\U00110000\"\n",
+        // a line ending backslash is only allowed in multi-line strings.
+        "a = \"\\ \n\"\n"
+    };
+    for(size_t i = 0; i < sizeof(invalid) / sizeof(invalid[0]); ++i) {
+        scan(&sc, invalid[i]);
+        CHECK(sc.had_error);
+    }
+
+    // strings are NUL terminated, so NUL can't be escaped.
+    scan(&sc, "a = \"\\u0000\"\n");
+    CHECK(sc.had_error);
+    scan(&sc, "a = \"x\\U00000000\"\n");
+    CHECK(sc.had_error);
+
+    // scanning resumes after the string that has an invalid escape sequence,
+    // and only that escape sequence is reported.
+    char errors[512];
+    scan_errors(&sc, "a = \"bad \\q \\x \\\" ] b\" c\n", errors, sizeof(errors));
+    CHECK(types_are(&sc, (TokenType[]){TK_IDENTIFIER, TK_EQUAL, TK_ERROR, TK_IDENTIFIER, TK_NEWLINE, TK_EOF}));
+    CHECK(text_is(&sc, 3, "c"));
+    CHECK(count_lines(errors) == 1 && strstr(errors, "'\\q'"));
+    scan_errors(&sc, "m = \"\"\"\\q\n\"\"\"\nn = 1\n", errors, sizeof(errors));
+    CHECK(types_are(&sc, (TokenType[]){TK_IDENTIFIER, TK_EQUAL, TK_ERROR, TK_NEWLINE,
+                                       TK_IDENTIFIER, TK_EQUAL, TK_NUMBER, TK_NEWLINE, TK_EOF}));
+    CHECK(count_lines(errors) == 1);
+
+    // a backslash at the end of the source is an unterminated string.
+    size_t reported = scan_errors(&sc, "a = \"abc\\", errors, sizeof(errors));
+    CHECK(sc.had_error);
+    // without a NUL byte in the message.
+    CHECK(reported == strlen(errors));
+    CHECK(count_lines(errors) == 1 && strstr(errors, "Unterminated string"));
+
+    scan(&sc, "a = \"\"\"one \\  \n   two\"\"\"\n");
+    CHECK(types_are(&sc, (TokenType[]){TK_IDENTIFIER, TK_EQUAL, TK_STRING, TK_NEWLINE, TK_EOF}));
+    CHECK(!sc.had_error);
+}
+
+static void test_comments(void) {
+    Scanned sc;
+    scan(&sc, "# only a comment\na = 1 # trailing");
+    CHECK(types_are(&sc, (TokenType[]){TK_IDENTIFIER, TK_EQUAL, TK_NUMBER, TK_EOF}));
+    scan(&sc, "a = 1 # no newline at the end#");
+    CHECK(types_are(&sc, (TokenType[]){TK_IDENTIFIER, TK_EQUAL, TK_NUMBER, TK_EOF}));
+    // the newline that ends a comment after a token is a token.
+    scan(&sc, "a = 1 # c\nb = 2\n  # own line\n# another\nc = 3\n");
+    CHECK(types_are(&sc, (TokenType[]){TK_IDENTIFIER, TK_EQUAL, TK_NUMBER, TK_NEWLINE,
+                                       TK_IDENTIFIER, TK_EQUAL, TK_NUMBER, TK_NEWLINE,
+                                       TK_IDENTIFIER, TK_EQUAL, TK_NUMBER, TK_NEWLINE, TK_EOF}));
+    scan(&sc, "a = \"# not a comment\"\n");
+    CHECK(text_is(&sc, 2, "# not a comment"));
+}
+
+static void test_quoted_keys(void) {
+    Scanned sc;
+    scan(&sc, "[\"Zürich\"]\n'key with spaces' = 1\n");
+    CHECK(types_are(&sc, (TokenType[]){TK_LBRACKET, TK_STRING, TK_RBRACKET, TK_NEWLINE,
+                                       TK_STRING, TK_EQUAL, TK_NUMBER, TK_NEWLINE, TK_EOF}));
+    CHECK(text_is(&sc, 1, "Zürich"));
+    CHECK(text_is(&sc, 4, "key with spaces"));
+
+    // non-ASCII characters need quotes.
+    scan(&sc, "clé = 1\n");
+    CHECK(sc.had_error);
+}
+
+static void test_literals(void) {
+    Scanned sc;
+    scan(&sc, "d = 1979-05-27T07:32:00-08:00\n"
+              "e = 1970-01-01\n"
+              "f = 1970-01-01 00:00:01.5\n"
+              "t = 1h30m15s\n"
+              "s = 16MiB\n"
+              "b = false\n");
+    CHECK(types_are(&sc, (TokenType[]){TK_IDENTIFIER, TK_EQUAL, TK_DATETIME, TK_NEWLINE,
+                                       TK_IDENTIFIER, TK_EQUAL, TK_DATETIME, TK_NEWLINE,
+                                       TK_IDENTIFIER, TK_EQUAL, TK_DATETIME, TK_NEWLINE,
+                                       TK_IDENTIFIER, TK_EQUAL, TK_DURATION, TK_NEWLINE,
+                                       TK_IDENTIFIER, TK_EQUAL, TK_SIZE, TK_NEWLINE,
+                                       TK_IDENTIFIER, TK_EQUAL, TK_FALSE, TK_NEWLINE, TK_EOF}));
+    CHECK(sc.tokens[2].as.number == 296667120LL * 1000000000);
+    CHECK(sc.tokens[6].as.number == 0);
+    CHECK(sc.tokens[10].as.number == 1500000000);
+    CHECK(sc.tokens[14].as.number == (3600 + 30 * 60 + 15) * 1000000000LL);
+    CHECK(sc.tokens[18].as.number == 16 << 20);
+
+    const char *invalid[] = {
+        "d = 2023-02-29\n",
+        "d = 2024-13-01\n",
+        "d = 2024-01-01T25:00:00\n",
+        "t = 10parsecs\n",
+        "s = 1KiB2MiB\n"
+    };
+    for(size_t i = 0; i < sizeof(invalid) / sizeof(invalid[0]); ++i) {
+        scan(&sc, invalid[i]);
+        CHECK(sc.had_error);
+    }
+}
+
+static void test_numbers(void) {
+    Scanned sc;
+    scan(&sc, "a = 1_000\n"
+              "b = 9223372036854775807\n"
+              "c = 1_024KiB\n"
+              "d = 1_500ms\n"
+              "e = 07:32:00\n"
+              "f = 23:59:59.25\n");
+    CHECK(types_are(&sc, (TokenType[]){TK_IDENTIFIER, TK_EQUAL, TK_NUMBER, TK_NEWLINE,
+                                       TK_IDENTIFIER, TK_EQUAL, TK_NUMBER, TK_NEWLINE,
+                                       TK_IDENTIFIER, TK_EQUAL, TK_SIZE, TK_NEWLINE,
+                                       TK_IDENTIFIER, TK_EQUAL, TK_DURATION, TK_NEWLINE,
+                                       TK_IDENTIFIER, TK_EQUAL, TK_DATETIME, TK_NEWLINE,
+                                       TK_IDENTIFIER, TK_EQUAL, TK_DATETIME, TK_NEWLINE, TK_EOF}));
+    CHECK(sc.tokens[2].as.number == 1000);
+    CHECK(sc.tokens[6].as.number == INT64_MAX);
+    CHECK(sc.tokens[10].as.number == 1024 << 10);
+    CHECK(sc.tokens[14].as.number == 1500000000);
+    // local times are nanoseconds since midnight.
+    CHECK(sc.tokens[18].as.number == (7 * 3600 + 32 * 60) * 1000000000LL);
+    CHECK(sc.tokens[22].as.number == (23 * 3600 + 59 * 60 + 59) * 1000000000LL + 250000000);
+
+    // out of range values are rejected, not wrapped.
+    const char *invalid[] = {
+        "a = 9223372036854775808\n",
+        "a = 99999999999999999999\n",
+        "s = 9999999999TiB\n",
+        "t = 1000000d\n",
+        "t = 106751d23h47m16s854ms775us808ns\n",
+        "a = 1__000\n",
+        "a = 1000_\n",
+        "s = 1_KiB\n",
+        "e = 24:00:00\n",
+        "e = 07:32\n",
+        "e = 07:32:00x\n"
+    };
+    for(size_t i = 0; i < sizeof(invalid) / sizeof(invalid[0]); ++i) {
+        scan(&sc, invalid[i]);
+        CHECK(sc.had_error);
+    }
+    // the largest duration that fits, and 100000 days (about 274 years) fit as well.
+    scan(&sc, "t = 106751d23h47m16s854ms775us807ns\nu = 100000d\n");
+    CHECK(!sc.had_error);
+    CHECK(sc.tokens[2].as.number == INT64_MAX);
+    CHECK(sc.tokens[6].as.number == 100000LL * 86400 * 1000000000);
+}
+
+static void test_lines(void) {
+    Scanner s;
+    char source[] = "a = 1\n\nb = 2\nc = 3\n";
+    scannerInit(&s, source);
+    CHECK(scannerLine(&s, 0) == 1);
+    CHECK(scannerLine(&s, 7) == 3);
+    CHECK(scannerLine(&s, 13) == 4);
+    // backwards from the cached position.
+    CHECK(scannerLine(&s, 6) == 2);
+    scannerFree(&s);
+}
+
+// scannerScan() returns the stream of scannerNextToken() without the error tokens.
+static void test_batches(void) {
+    Scanned sc;
+    const char *source = "[t]\na = 1\nb = ?\nc = 'x'\n";
+    scan(&sc, source);
+    char copy[256];
+    snprintf(copy, sizeof(copy), "%s", source);
+    Scanner s;
+    scannerInit(&s, copy);
+    Token batch[3];
+    size_t n, seen = 0;
+    do {
+        n = scannerScan(&s, batch, 3);
+        for(size_t i = 0; i < n; ++i, ++seen) {
+            while(sc.tokens[seen].type == TK_ERROR) {
+                seen++;
+            }
+            CHECK(batch[i].type == sc.tokens[seen].type && batch[i].at == sc.tokens[seen].at);
+        }
+    } while(batch[n - 1].type != TK_EOF);
+    CHECK(seen == sc.count);
+    CHECK(s.had_error);
+    // the EOF token is returned again.
+    CHECK(scannerScan(&s, batch, 3) == 1 && batch[0].type == TK_EOF);
+    scannerFree(&s);
+}
+
+int main(void) {
+    test_pairs_and_tables();
+    test_strings();
+    test_escapes();
+    test_comments();
+    test_quoted_keys();
+    test_literals();
+    test_numbers();
+    test_lines();
+    test_batches();
+    return TEST_RESULT();
+}
@@ -0,0 +1,39 @@
+// The inline getters of the single header (see README.md).
+// test_single_header_cpp compiles this file as C++.
+
+#define CONFIG_PARSER_INLINE
+#include "config_parser.h"
+#include "test.h"
+
+int main(void) {
+    char dir[64], path[PATH_MAX];
+    if(!testMakeDir(dir) || !testWriteFile(path, dir, "a.config", "name = \"app\"\nport = 8080\nverbose = true\ntimeout = 1m30s\n")) {
+        fprintf(stderr, "can't write the test configuration\n");
+        return EXIT_FAILURE;
+    }
+    ConfigParser p;
+    ConfigTable *t = config_parse(&p, path);
+    CHECK(t != NULL);
+    if(t) {
+        for(int frozen = 0; frozen < 2; ++frozen) {
+            ConfigValue v = config_get_string_inline(t, "name");
+            CHECK(v.ok);
+            CHECK_STR(v.as.string, "app");
+            v = config_get_number_inline(t, "port");
+            CHECK(v.ok && v.as.number == 8080);
+            v = config_get_boolean_inline(t, "verbose");
+            CHECK(v.ok && v.as.boolean);
+            v = config_get_duration_inline(t, "timeout");
+            CHECK(v.ok && v.as.duration == 90LL * 1000000000);
+            // the wrong type and a missing key.
+            CHECK(!config_get_number_inline(t, "name").ok);
+            CHECK(!config_get_number_inline(t, "missing").ok);
+            CHECK(config_get_type_inline(t, "missing") == CONFIG_TYPE_NONE);
+            CHECK(config_get_number_or_inline(t, "missing", 7) == 7);
+            CHECK(config_freeze(&p));
+        }
+        config_end(&p);
+    }
+    testRemoveDir(dir);
+    return TEST_RESULT();
+}
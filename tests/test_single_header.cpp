@@ -0,0 +1,3 @@
+// The single header has to be usable from C++ (test_single_header.c is valid C++).
+
+#include "test_single_header.c"
@@ -0,0 +1,291 @@
+// The snapshot cache of config_parse_cached() and config_cache_prune() (see snapshot.h).
+
+#include <errno.h>
+#include <time.h>
+#include <fcntl.h> // AT_FDCWD
+#include <sys/stat.h> // mkdir, chmod, utimensat
+#include "array.h"
+#include "arena.h"
+#include "config_parser.h"
+#include "config_internal.h"
+#include "snapshot.h"
+#include "test.h"
+
+static char dir[64], cache[PATH_MAX];
+
+// Write a file in the test directory and store its path in 'path' (PATH_MAX bytes).
+static void write_file(char *path, const char *name, const char *contents) {
+    CHECK(testWriteFile(path, dir, name, contents));
+}
+
+// The number of snapshots in the cache, the path of the last one is stored in 'path' (PATH_MAX bytes).
+static size_t find_snapshots(char *path) {
+    size_t count = 0;
+    DIR *d = opendir(cache);
+    struct dirent *entry;
+    while(d && (entry = readdir(d))) {
+        const char *suffix = strrchr(entry->d_name, '.');
+        if(suffix && !strcmp(suffix, ".snapshot") && testPath(path, cache, entry->d_name)) {
+            count++;
+        }
+    }
+    if(d) {
+        closedir(d);
+    }
+    return count;
+}
+
+// Load the snapshot of the current version of the file at 'path' as if its contents were 'contents'.
+// 'distinct' (may be NULL) is set to the number of tables whose keys the snapshot marks as distinct.
+static bool load_tables(const char *path, const char *contents, size_t *distinct) {
+    struct stat st;
+    if(stat(path, &st) < 0) {
+        return false;
+    }
+    Arena arena;
+    Array tables;
+    arenaInit(&arena);
+    arrayInitArena(&tables, &arena);
+    bool loaded = snapshotLoad(cache, path, &st, contents, strlen(contents), &tables, &arena);
+    for(size_t i = 0; loaded && distinct && i < tables.used; ++i) {
+        *distinct += ARRAY_GET_AS(ConfigTable *, &tables, i)->distinct_keys;
+    }
+    arenaFree(&arena);
+    return loaded;
+}
+
+static bool load(const char *path, const char *contents) {
+    return load_tables(path, contents, NULL);
+}
+
+static int64_t parse_port(const char *path) {
+    ConfigParser p;
+    ConfigTable *top = config_parse_cached(&p, path, cache);
+    if(!top) {
+        return -1;
+    }
+    int64_t port = config_get_number_or(top, "port", -1);
+    config_end(&p);
+    return port;
+}
+
+static bool copy_file(const char *from, const char *to) {
+    char buffer[4096];
+    FILE *in = fopen(from, "rb"), *out = fopen(to, "wb");
+    size_t n = in && out ? fread(buffer, 1, sizeof(buffer), in) : 0;
+    bool ok = in && out && fwrite(buffer, 1, n, out) == n;
+    if(in) {
+        fclose(in);
+    }
+    return out && fclose(out) == 0 && ok;
+}
+
+static void test_warm_load(void) {
+    char path[PATH_MAX], snapshot[PATH_MAX];
+    const char *contents = "port = 8080\n\n[db]\nhost = \"localhost\"\n";
+    write_file(path, "warm.toml", contents);
+    CHECK(!load(path, contents));
+    CHECK(parse_port(path) == 8080);
+    CHECK(find_snapshots(snapshot) == 1);
+    // the next parse loads the snapshot.
+    CHECK(load(path, contents));
+    CHECK(parse_port(path) == 8080);
+    testRemoveDir(cache);
+    CHECK(mkdir(cache, 0700) == 0);
+}
+
+static void test_corrupt_snapshot(void) {
+    char path[PATH_MAX], snapshot[PATH_MAX];
+    const char *contents = "port = 443\n";
+    write_file(path, "corrupt.toml", contents);
+    CHECK(parse_port(path) == 443);
+    CHECK(find_snapshots(snapshot) == 1);
+
+    // flip a byte of the pairs, which the checksum catches.
+    struct stat st;
+    CHECK(stat(snapshot, &st) == 0);
+    FILE *fp = fopen(snapshot, "r+b");
+    CHECK(fp);
+    if(fp) {
+        fseek(fp, st.st_size / 2, SEEK_SET);
+        int c = fgetc(fp);
+        fseek(fp, st.st_size / 2, SEEK_SET);
+        fputc(c ^ 0x40, fp);
+        fclose(fp);
+    }
+    CHECK(!load(path, contents));
+    // the file is parsed and the snapshot is replaced.
+    CHECK(parse_port(path) == 443);
+    CHECK(load(path, contents));
+
+    // a truncated snapshot.
+    CHECK(truncate(snapshot, 20) == 0);
+    CHECK(!load(path, contents));
+    CHECK(parse_port(path) == 443);
+    CHECK(load(path, contents));
+    testRemoveDir(cache);
+    CHECK(mkdir(cache, 0700) == 0);
+}
+
+static void test_other_contents(void) {
+    char a[PATH_MAX], b[PATH_MAX], snapshot_a[PATH_MAX], snapshot_b[PATH_MAX];
+    write_file(a, "a.toml", "port = 1\n");
+    write_file(b, "b.toml", "port = 2\n");
+    CHECK(parse_port(a) == 1);
+    CHECK(find_snapshots(snapshot_a) == 1);
+    CHECK(unlink(snapshot_a) == 0);
+    CHECK(parse_port(b) == 2);
+    CHECK(find_snapshots(snapshot_b) == 1);
+    // a valid snapshot with the name of another file's snapshot (as with a hash collision)
+    // isn't used for it, as it wasn't made from that file.
+    CHECK(copy_file(snapshot_b, snapshot_a));
+    CHECK(!load(a, "port = 1\n"));
+    CHECK(parse_port(a) == 1);
+    testRemoveDir(cache);
+    CHECK(mkdir(cache, 0700) == 0);
+}
+
+static void test_changed_file(void) {
+    char path[PATH_MAX], snapshot[PATH_MAX];
+    write_file(path, "changed.toml", "port = 1\n");
+    CHECK(parse_port(path) == 1);
+    write_file(path, "changed.toml", "port = 2\n");
+    CHECK(!load(path, "port = 2\n"));
+    CHECK(parse_port(path) == 2);
+    // the new snapshot replaced the previous one.
+    CHECK(find_snapshots(snapshot) == 1);
+    CHECK(load(path, "port = 2\n"));
+    CHECK(!load(path, "port = 1\n"));
+
+    // and the snapshot of a file isn't used for another file with the same contents.
+    char copy[PATH_MAX];
+    write_file(copy, "copy.toml", "port = 2\n");
+    CHECK(!load(copy, "port = 2\n"));
+    testRemoveDir(cache);
+    CHECK(mkdir(cache, 0700) == 0);
+}
+
+static void test_file_identity(void) {
+    char path[PATH_MAX], moved[PATH_MAX];
+    write_file(path, "identity.toml", "port = 1\n");
+    CHECK(parse_port(path) == 1);
+    CHECK(load(path, "port = 1\n"));
+
+    // new contents of the same size with the previous mtime, which only the hash tells apart.
+    struct stat st;
+    CHECK(stat(path, &st) == 0);
+    write_file(path, "identity.toml", "port = 2\n");
+    struct timespec times[2] = {st.st_atim, st.st_mtim};
+    CHECK(utimensat(AT_FDCWD, path, times, 0) == 0);
+    CHECK(!load(path, "port = 2\n"));
+    CHECK(parse_port(path) == 2);
+    CHECK(load(path, "port = 2\n"));
+
+    // the same contents with another mtime, or in another inode, are parsed again.
+    times[1].tv_sec -= 10;
+    CHECK(utimensat(AT_FDCWD, path, times, 0) == 0);
+    CHECK(!load(path, "port = 2\n"));
+    CHECK(parse_port(path) == 2);
+    write_file(moved, "identity.new", "port = 2\n");
+    CHECK(utimensat(AT_FDCWD, moved, times, 0) == 0);
+    CHECK(rename(moved, path) == 0);
+    CHECK(!load(path, "port = 2\n"));
+    CHECK(parse_port(path) == 2);
+    CHECK(load(path, "port = 2\n"));
+    testRemoveDir(cache);
+    CHECK(mkdir(cache, 0700) == 0);
+}
+
+static void test_distinct_keys(void) {
+    char path[PATH_MAX];
+    // the snapshot records which tables don't define a key twice.
+    write_file(path, "distinct.toml", "port = 1\nport = 2\n\n[t]\na = 1\nb = 2\n");
+    CHECK(parse_port(path) == 2);
+    size_t distinct = 0;
+    CHECK(load_tables(path, "port = 1\nport = 2\n\n[t]\na = 1\nb = 2\n", &distinct));
+    CHECK(distinct == 1);
+    // and the later definition still wins when the tables are loaded from it.
+    CHECK(parse_port(path) == 2);
+    testRemoveDir(cache);
+    CHECK(mkdir(cache, 0700) == 0);
+}
+
+static bool cache_has(const char *name) {
+    char path[PATH_MAX];
+    return testPath(path, cache, name) && access(path, F_OK) == 0;
+}
+
+static void test_prune(void) {
+    char kept[PATH_MAX], deleted[PATH_MAX], path[PATH_MAX], snapshot[PATH_MAX];
+    write_file(kept, "kept.toml", "port = 1\n");
+    write_file(deleted, "deleted.toml", "port = 2\n");
+    CHECK(parse_port(kept) == 1);
+    CHECK(parse_port(deleted) == 2);
+    CHECK(find_snapshots(snapshot) == 2);
+    CHECK(unlink(deleted) == 0);
+
+    // a temporary file left by a writer that died, one being written, a corrupt snapshot and another file.
+    CHECK(testWriteFile(path, cache, ".0123456789abcdef.1.0.tmp", "partial"));
+    struct timespec old[2] = {{time(NULL) - 3600, 0}, {time(NULL) - 3600, 0}};
+    CHECK(utimensat(AT_FDCWD, path, old, 0) == 0);
+    CHECK(testWriteFile(path, cache, ".0123456789abcdef.1.1.tmp", "partial"));
+    CHECK(testWriteFile(path, cache, "0000000000000000.snapshot", "corrupt"));
+    CHECK(testWriteFile(path, cache, "notes.txt", "not a snapshot"));
+
+    CHECK(config_cache_prune(cache));
+    CHECK(find_snapshots(snapshot) == 1);
+    CHECK(load(kept, "port = 1\n"));
+    CHECK(!cache_has(".0123456789abcdef.1.0.tmp"));
+    CHECK(cache_has(".0123456789abcdef.1.1.tmp"));
+    CHECK(!cache_has("0000000000000000.snapshot"));
+    CHECK(cache_has("notes.txt"));
+
+    CHECK(chmod(cache, 0777) == 0);
+    errno = 0;
+    CHECK(!config_cache_prune(cache) && errno == EACCES);
+    CHECK(chmod(cache, 0700) == 0);
+    errno = 0;
+    CHECK(!config_cache_prune(NULL) && errno == EINVAL);
+    testRemoveDir(cache);
+    CHECK(mkdir(cache, 0700) == 0);
+}
+
+static void test_untrusted_dir(void) {
+    char path[PATH_MAX], snapshot[PATH_MAX];
+    write_file(path, "trusted.toml", "port = 22\n");
+    CHECK(parse_port(path) == 22);
+    CHECK(find_snapshots(snapshot) == 1);
+
+    // a cache directory others can write to is refused.
+    int modes[] = {0770, 0777, 0730};
+    for(size_t i = 0; i < sizeof(modes) / sizeof(modes[0]); ++i) {
+        CHECK(chmod(cache, modes[i]) == 0);
+        ConfigParser p;
+        errno = 0;
+        CHECK(config_parse_cached(&p, path, cache) == NULL);
+        CHECK(errno == EACCES);
+        CHECK(!load(path, "port = 22\n"));
+    }
+    CHECK(chmod(cache, 0755) == 0);
+    CHECK(load(path, "port = 22\n"));
+    CHECK(chmod(cache, 0700) == 0);
+}
+
+int main(void) {
+    if(!testMakeDir(dir)) {
+        fprintf(stderr, "can't create the test directory\n");
+        return EXIT_FAILURE;
+    }
+    CHECK(testPath(cache, dir, "cache"));
+    CHECK(mkdir(cache, 0700) == 0);
+    test_warm_load();
+    test_corrupt_snapshot();
+    test_other_contents();
+    test_changed_file();
+    test_file_identity();
+    test_distinct_keys();
+    test_prune();
+    test_untrusted_dir();
+    testRemoveDir(dir);
+    return TEST_RESULT();
+}
@@ -0,0 +1,104 @@
+// utf8Validate() around the 16-byte blocks of the SSE2 path.
+// The same file is built without SIMD (test_utf8_scalar), so both builds have to report the same offsets.
+
+#include "utf8.h"
+#include "test.h"
+
+#define BUFFER_SIZE 64
+
+// The offsets utf8Validate() reports, one sequence at a time.
+static size_t reference_validate(const char *s, size_t length) {
+    const unsigned char *bytes = (const unsigned char *)s;
+    size_t i = 0;
+    while(i < length) {
+        size_t n = utf8SequenceLength(bytes + i, length - i);
+        if(n == 0) {
+            return i;
+        }
+        i += n;
+    }
+    return length;
+}
+
+// An ASCII buffer of 'length' bytes with 'sequence' written at 'offset'.
+static void fill(char *buffer, size_t length, size_t offset, const char *sequence) {
+    memset(buffer, 'a', length);
+    memcpy(buffer + offset, sequence, strlen(sequence));
+}
+
+static void check_offset(const char *buffer, size_t length, size_t expected) {
+    size_t offset = utf8Validate(buffer, length);
+    if(offset != expected || reference_validate(buffer, length) != expected) {
+        fprintf(stderr, "length %zu: utf8Validate() = %zu, expected %zu\n", length, offset, expected);
+        CHECK(offset == expected);
+        CHECK(reference_validate(buffer, length) == expected);
+    }
+}
+
+static const char *sequences[] = {"\xc3\xa9", "\xe2\x82\xac", "\xf0\x9f\x98\x80"};
+
+static void test_straddling_sequences(void) {
+    char buffer[BUFFER_SIZE];
+    // every sequence at every offset of the first blocks, straddling the boundaries at 16 and 32.
+    for(size_t s = 0; s < sizeof(sequences) / sizeof(sequences[0]); ++s) {
+        size_t n = strlen(sequences[s]);
+        for(size_t offset = 0; offset + n <= 40; ++offset) {
+            fill(buffer, 40, offset, sequences[s]);
+            check_offset(buffer, 40, 40);
+            // the last byte of the sequence isn't a continuation byte.
+            buffer[offset + n - 1] = 'a';
+            check_offset(buffer, 40, offset);
+        }
+    }
+    // an invalid continuation byte right after a boundary.
+    fill(buffer, 40, 15, "\xe2\x82\x28");
+    check_offset(buffer, 40, 15);
+    // a surrogate split by a boundary.
+    fill(buffer, 40, 14, "\xed\xa0\x80");
+    check_offset(buffer, 40, 14);
+}
+
+static void test_truncated_end(void) {
+    char buffer[BUFFER_SIZE];
+    // the input ends after the first bytes of a sequence, with and without a full block before it.
+    for(size_t s = 0; s < sizeof(sequences) / sizeof(sequences[0]); ++s) {
+        size_t n = strlen(sequences[s]);
+        for(size_t length = n - 1; length <= 40; ++length) {
+            for(size_t kept = 1; kept < n; ++kept) {
+                size_t offset = length - kept;
+                fill(buffer, length, offset, "");
+                memcpy(buffer + offset, sequences[s], kept);
+                check_offset(buffer, length, offset);
+            }
+        }
+    }
+}
+
+static void test_scalar_tail(void) {
+    char buffer[BUFFER_SIZE];
+    // an invalid byte after the last full block, at every offset of the tail.
+    for(size_t length = 33; length < 48; ++length) {
+        for(size_t offset = 32; offset < length; ++offset) {
+            fill(buffer, length, offset, "\xff");
+            check_offset(buffer, length, offset);
+            // a valid sequence in the last block before it.
+            memcpy(buffer + 30, "\xc3\xa9", 2);
+            check_offset(buffer, length, offset);
+        }
+    }
+    // a lone continuation byte and an overlong encoding in the tail.
+    fill(buffer, 37, 35, "\x80");
+    check_offset(buffer, 37, 35);
+    fill(buffer, 37, 34, "\xc0\xaf");
+    check_offset(buffer, 37, 34);
+    // shorter than a block.
+    check_offset("ab\xff", 3, 2);
+    check_offset("", 0, 0);
+}
+
+int main(void) {
+    test_straddling_sequences();
+    test_truncated_end();
+    test_scalar_tail();
+    return TEST_RESULT();
+}